@@ -0,0 +1,334 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* as.c --- Address spaces of processes.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include "umps/types.h"
+
+#include "as.h"
+#include "page.h"
+#include "atomic.h"
+#include "tod.h"
+
+#ifdef HOST
+/* Built as a Linux program (see host/): there is no TLB.  */
+#include <stdlib.h>
+#define TLBCLR()
+#define TLBWR()
+#define TLBWI()
+#define TLBP()
+#define getINDEX() 0x80000000
+#define setENTRYHI(hi) ((void) (hi))
+#define setENTRYLO(lo) ((void) (lo))
+#define LDST(s)
+#define PANIC() abort()
+#else
+#include "umps/libumps.h"
+#endif
+
+/* Where the ROM saves the state of the processor on a TLB exception.  */
+#ifndef TLB_OLDAREA
+#define TLB_OLDAREA 0x20000118
+#endif
+
+#define ASID_MASK (AS_NASID - 1)
+#define EXC_MOD 1
+#define INDEX_PROBE_FAIL 0x80000000
+
+#define VPN_START (AS_KUSEG_START >> 12)
+#define VPN_STACK ((AS_KUSEG_STACK >> 12) - 1)
+
+/* ASID and generation last handed out.  ASID 0 belongs to the kernel,
+ * and generation 0 to address spaces that never had an ASID. */
+static unsigned int asidLast;
+static int asidLock;
+
+/* Generation whose entries the TLB of each processor may hold. */
+static unsigned int CPU_GEN[MAXCPU];
+/* Address space of the process running on each processor. */
+static aspace_t *CPU_AS[MAXCPU];
+
+static asfault_t asFault;
+static asstats_t stats;
+
+
+
+/* A freed process gives its frames back. */
+static void asForget (pcb_t *p) {
+    asFree(getPAs(p));
+}
+
+
+void initAS (void) {
+    int i;
+
+    addFreeHook(asForget);
+    asidLast = AS_NASID;
+    asidLock = 0;
+    for (i = 0; i < MAXCPU; ++i) {
+        CPU_GEN[i] = 0;
+        CPU_AS[i] = NULL;
+    }
+    asFault = NULL;
+    stats.as_misses = 0;
+    stats.as_refillTicks = 0;
+    stats.as_faults = 0;
+    stats.as_asids = 0;
+    stats.as_rollovers = 0;
+    stats.as_cowCopies = 0;
+    stats.as_cowReuses = 0;
+}
+
+
+/* The user pages are the AS_NPTE-1 first pages of kuseg, then the stack
+ * page: return the index of the page of vaddr, or -1. */
+static int pteIndex (unsigned int vaddr) {
+    unsigned int vpn = vaddr >> 12;
+
+    if (vpn - VPN_START < AS_NPTE - 1)
+        return vpn - VPN_START;
+    if (vpn == VPN_STACK)
+        return AS_NPTE - 1;
+    return -1;
+}
+
+
+/* Replace the TLB entry of the page of vaddr in as, if the space runs
+ * on this processor.  If the TLB of another processor, or of this one
+ * while another space runs, may hold entries of as, the ASID is given up
+ * so that they are never used again; the space takes a new one at once
+ * if it is running here.  A processor running it meanwhile keeps its
+ * entry until it activates a space (see asSetPte). */
+static void tlbUpdate (aspace_t *as, unsigned int vaddr) {
+    int cpu = cpuId();
+    unsigned int hi;
+
+    if (CPU_AS[cpu] == as) {
+        hi = (as->as_asid & ASID_MASK) << AS_ASID_SHIFT;
+        setENTRYHI((vaddr & AS_VPN_MASK) | hi);
+        TLBP();
+        if (!(getINDEX() & INDEX_PROBE_FAIL)) {
+            setENTRYLO(asEntryLo(as, vaddr) & ~AS_COW);
+            TLBWI();
+        }
+        setENTRYHI(hi);
+    }
+
+    if (CPU_AS[cpu] != as || (as->as_cpus & ~(1u << cpu))) {
+        as->as_asid = 0;
+        if (CPU_AS[cpu] == as)
+            asActivate(as);
+    }
+}
+
+
+int asMap (aspace_t *as, unsigned int vaddr, unsigned int frame,
+           int writable) {
+    int i = pteIndex(vaddr);
+
+    if (as == NULL || i < 0)
+        return 0;
+
+    asSetPte(as, vaddr, (frame & AS_PFN_MASK) | AS_VALID |
+             (writable ? AS_DIRTY : 0));
+    return 1;
+}
+
+
+void asUnmap (aspace_t *as, unsigned int vaddr) {
+    asSetPte(as, vaddr, 0);
+}
+
+
+void asFree (aspace_t *as) {
+    int i;
+
+    if (as == NULL)
+        return;
+
+    for (i = 0; i < AS_NPTE; ++i) {
+        if (as->as_pte[i] & AS_VALID)
+            pageUnref(as->as_pte[i] & AS_PFN_MASK);
+        as->as_pte[i] = 0;
+    }
+    as->as_asid = 0;
+}
+
+
+/* Writable pages become read-only and copy-on-write in both spaces; the
+ * parent's TLB entries that still allow writing are dropped with its
+ * ASID. */
+int asFork (aspace_t *parent, aspace_t *child) {
+    unsigned int pte;
+    int i;
+
+    if (parent == NULL || child == NULL || parent == child)
+        return 0;
+    for (i = 0; i < AS_NPTE; ++i)
+        if (parent->as_pte[i] & AS_PAGED)
+            return 0;
+
+    for (i = 0; i < AS_NPTE; ++i) {
+        pte = parent->as_pte[i];
+        if (pte & AS_VALID) {
+            if (pte & (AS_DIRTY | AS_COW))
+                pte = (pte & ~AS_DIRTY) | AS_COW;
+            pageRef(pte & AS_PFN_MASK);
+            parent->as_pte[i] = pte;
+        }
+        if (child->as_pte[i] & AS_VALID)
+            pageUnref(child->as_pte[i] & AS_PFN_MASK);
+        child->as_pte[i] = pte;
+    }
+
+    parent->as_asid = 0;
+    child->as_asid = 0;
+    if (CPU_AS[cpuId()] == parent)
+        asActivate(parent);
+    return 1;
+}
+
+
+/* Copy the frame at from to the frame at to, a word at a time. */
+static void frameCopy (unsigned int to, unsigned int from) {
+    unsigned int *d = (unsigned int *) (unsigned long) to;
+    unsigned int *s = (unsigned int *) (unsigned long) from;
+    int i;
+
+    for (i = 0; i < PAGESIZE / (int) sizeof(*d); ++i)
+        d[i] = s[i];
+}
+
+
+/* Only a valid entry can be in a TLB. */
+void asSetPte (aspace_t *as, unsigned int vaddr, unsigned int pte) {
+    int i = pteIndex(vaddr);
+    unsigned int old;
+
+    if (as == NULL || i < 0)
+        return;
+
+    old = as->as_pte[i];
+    as->as_pte[i] = pte;
+    if (old & AS_VALID) {
+        pageUnref(old & AS_PFN_MASK);
+        tlbUpdate(as, vaddr);
+    }
+}
+
+
+/* The last space to write to a shared frame just takes it over. */
+int asWriteFault (aspace_t *as, unsigned int vaddr) {
+    int i = pteIndex(vaddr);
+    unsigned int frame;
+    unsigned int copy;
+
+    if (as == NULL || i < 0 || !(as->as_pte[i] & AS_COW))
+        return 0;
+
+    frame = as->as_pte[i] & AS_PFN_MASK;
+    if (pageRefs(frame) == 1) {
+        as->as_pte[i] = (as->as_pte[i] & ~AS_COW) | AS_DIRTY;
+        ++stats.as_cowReuses;
+    }
+    else {
+        copy = allocPage();
+        if (copy == 0)
+            return 0;
+        frameCopy(copy, frame);
+        pageUnref(frame);
+        as->as_pte[i] = copy | AS_VALID | AS_DIRTY;
+        ++stats.as_cowCopies;
+    }
+
+    tlbUpdate(as, vaddr);
+    return 1;
+}
+
+
+unsigned int asEntryLo (aspace_t *as, unsigned int hi) {
+    int i = pteIndex(hi);
+
+    return i < 0 ? 0 : as->as_pte[i];
+}
+
+
+/* An ASID is handed out again only after a rollover, once every TLB
+ * that may hold its entries has been cleared. */
+void asActivate (aspace_t *as) {
+    int cpu = cpuId();
+
+    if (as == NULL)
+        return;
+
+    if ((as->as_asid ^ asidLast) & ~ASID_MASK) {
+        spinLock(&asidLock);
+        if ((++asidLast & ASID_MASK) == 0) {
+            ++asidLast;
+            ++stats.as_rollovers;
+        }
+        as->as_asid = asidLast;
+        as->as_cpus = 0;
+        ++stats.as_asids;
+        spinUnlock(&asidLock);
+    }
+
+    if (CPU_GEN[cpu] != (as->as_asid & ~ASID_MASK)) {
+        TLBCLR();
+        CPU_GEN[cpu] = as->as_asid & ~ASID_MASK;
+    }
+
+    CPU_AS[cpu] = as;
+    as->as_cpus |= 1u << cpu;
+    setENTRYHI((as->as_asid & ASID_MASK) << AS_ASID_SHIFT);
+}
+
+
+/* The refill path is kept short: one lookup in the page table of the
+ * current address space, a TLBWR and back.  A write to a copy-on-write
+ * page is a modification exception. */
+void tlbHandler (void) {
+    state_t *old = (state_t *) TLB_OLDAREA;
+    unsigned int start = readTOD();
+    aspace_t *as = CPU_AS[cpuId()];
+    unsigned int lo;
+
+    if (as != NULL && ((old->cause >> 2) & 0x1F) != EXC_MOD) {
+        lo = asEntryLo(as, old->entry_hi);
+        if (lo & AS_VALID) {
+            setENTRYHI(old->entry_hi);
+            setENTRYLO(lo & ~AS_COW);
+            TLBWR();
+            ++stats.as_misses;
+            stats.as_refillTicks += readTOD() - start;
+            LDST(old);
+            return;
+        }
+    }
+    else if (as != NULL && asWriteFault(as, old->entry_hi)) {
+        LDST(old);
+        return;
+    }
+
+    ++stats.as_faults;
+    if (asFault == NULL)
+        PANIC();
+    asFault(old);
+}
+
+
+void asSetFault (asfault_t fault) {
+    asFault = fault;
+}
+
+
+void asStats (asstats_t *out) {
+    if (out != NULL)
+        *out = stats;
+}
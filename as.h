@@ -0,0 +1,134 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* as.h --- Address spaces of processes.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef AS_H
+#define AS_H
+
+#include "proc.h"
+
+/* A user address space has AS_NPTE pages: AS_NPTE-1 pages from
+   AS_KUSEG_START, and the stack page just below AS_KUSEG_STACK.  */
+#define AS_NPTE 32
+#define AS_KUSEG_START 0x80000000
+#define AS_KUSEG_STACK 0xC0000000
+
+/* Fields of the EntryHi and EntryLo registers.  */
+#define AS_VPN_MASK   0xFFFFF000
+#define AS_PFN_MASK   0xFFFFF000
+#define AS_ASID_SHIFT 6
+#define AS_NASID      64
+#define AS_DIRTY      0x00000400	/* Writable.  */
+#define AS_VALID      0x00000200
+/* Ignored by the TLB: the page is shared and copied on the first write.  */
+#define AS_COW        0x00000001
+/* Ignored by the TLB: the page belongs to a pager (see swap.h), which
+   owns its frame and slot alone.  */
+#define AS_PAGED      0x00000080
+
+/* Address space fields embedded in every process, see getPAs.  Page table
+   entries are the EntryLo values written in the TLB.  */
+struct aspace {
+    unsigned int as_asid;	/* ASID, and generation above it.  */
+    unsigned int as_cpus;	/* Processors that ran it with this ASID.  */
+    unsigned int as_pte[AS_NPTE];
+};
+
+typedef struct asstats {
+    unsigned int as_misses;	/* TLB refills.  */
+    unsigned int as_refillTicks;	/* TOD ticks spent in refills.  */
+    unsigned int as_faults;	/* Exceptions passed to the fault handler.  */
+    unsigned int as_asids;	/* ASIDs handed out.  */
+    unsigned int as_rollovers;	/* Times the ASIDs ran out.  */
+    unsigned int as_cowCopies;	/* Shared pages copied on a write.  */
+    unsigned int as_cowReuses;	/* Written pages that were no longer shared.  */
+} asstats_t;
+
+/* Called with the saved state of a TLB exception that is not a refill
+   of a valid page.  */
+typedef void (*asfault_t) (void *state);
+
+/* Initialize the module: every address space gets a new ASID when it is
+   next activated, and no fault handler is set.  From then on, freePcb
+   unmaps the pages of the processes it frees (see asFree).  Call it
+   after initProc.  */
+void initAS (void);
+
+/* Map the page of the virtual address `vaddr' in `as' to the frame at
+   `frame', giving `as' the caller's reference to the frame (see
+   pageRef).  A page mapped already is replaced as by asSetPte: the TLB
+   forgets the old entry.  Return FALSE if `vaddr' is not in a user
+   address space.  */
+int asMap (aspace_t *as, unsigned int vaddr, unsigned int frame,
+           int writable);
+
+/* Unmap the page of `vaddr' in `as' and drop its reference to the frame,
+   as asSetPte does.  */
+void asUnmap (aspace_t *as, unsigned int vaddr);
+
+/* Replace the page table entry of the page of `vaddr' in `as' with `pte',
+   e.g. to page it out (see swap.h).  The reference to the frame of the
+   old entry, if valid, is dropped, and the caller gives its own to the
+   frame of `pte' if valid.  The TLB forgets the old entry.  The bits the
+   TLB ignores, and the frame number of an invalid entry, are the
+   caller's.
+
+   Only the entry is replaced when `as' runs on this processor alone; if
+   the TLB of another processor may hold entries of `as', its ASID is
+   given up instead, and a new one is taken when it is next activated.
+   A processor that is running `as' at that time keeps using the old
+   entry until it activates a space: before the old frame is reused, the
+   caller must make it call asActivate (a TLB shootdown, e.g. on its next
+   timer interrupt; there is no interprocessor interrupt).  */
+void asSetPte (aspace_t *as, unsigned int vaddr, unsigned int pte);
+
+/* Unmap every page of `as', e.g. when its process ends; freePcb does it
+   (see initAS).  */
+void asFree (aspace_t *as);
+
+/* Make `child' share the pages of `parent', e.g. on a fork.  Writable
+   pages become copy-on-write in both: each space gets its own copy of
+   such a page when it first writes to it, unless the other has let go of
+   it already.  The pages `child' had are unmapped.  Return FALSE, and
+   change nothing, if the spaces are the same or `parent' has an AS_PAGED
+   page, which cannot be shared.  */
+int asFork (aspace_t *parent, aspace_t *child);
+
+/* Handle a write by `as' to the copy-on-write page of `vaddr', as
+   tlbHandler does.  Return FALSE if the page is not copy-on-write or no
+   frame is left for the copy.  */
+int asWriteFault (aspace_t *as, unsigned int vaddr);
+
+/* Return the page table entry of `as' for the virtual page in the EntryHi
+   value `hi', or 0 if there is none.  */
+unsigned int asEntryLo (aspace_t *as, unsigned int hi);
+
+/* Make `as' the address space of the current processor, e.g. when
+   dispatching its process: give it an ASID if it has none of the current
+   generation, and load that ASID in EntryHi.  The TLB entries of `as'
+   stay valid from one activation to the next.  When the ASIDs run out,
+   a new generation starts, and every processor clears its TLB on its
+   next activation.  */
+void asActivate (aspace_t *as);
+
+/* Handler of the TLB exceptions.  A miss on a valid page is refilled
+   from the page table of the current address space, and a write to a
+   copy-on-write page copies it; anything else is passed to the fault
+   handler.  */
+void tlbHandler (void);
+
+/* Set the handler of the TLB exceptions that are not refills.  Without
+   one, they stop the machine.  */
+void asSetFault (asfault_t fault);
+
+/* Fill `out' with the TLB statistics.  */
+void asStats (asstats_t *out);
+
+#endif
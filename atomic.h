@@ -0,0 +1,58 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* atomic.h --- Atomic operations shared by the processors.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+/* If the int at `p' is `ov', replace it with `nv' and return TRUE;
+   otherwise return FALSE.  Atomic with respect to the other processors.  */
+#ifdef HOST
+#define casInt(p, ov, nv) __sync_bool_compare_and_swap((p), (ov), (nv))
+#else
+#include "umps/libumps.h"
+#define casInt(p, ov, nv) \
+    CAS((unsigned int *) (p), (unsigned int) (ov), (unsigned int) (nv))
+#endif
+
+/* Read the int (resp. pointer) at `p' from memory, even in a loop.  */
+#define loadInt(p) (*(volatile int *) (p))
+#define loadPtr(p) (*(void * volatile *) (p))
+
+/* Make the memory accesses before it visible to the other processors
+   before the accesses after it.  */
+#ifdef HOST
+#define memBarrier() __sync_synchronize()
+#else
+/* uMPS processors share memory in program order: only the compiler must
+   not move accesses across it.  */
+#define memBarrier() __asm__ __volatile__ ("" : : : "memory")
+#endif
+
+/* Take and release the spinlock at `l', an int that is 0 when free.  */
+#define spinLock(l) do { } while (!casInt((l), 0, 1))
+#define spinUnlock(l) (*(volatile int *) (l) = 0)
+
+/* Return the number of the processor running the caller, from 0 to
+   MAXCPU-1.  */
+#ifndef MAXCPU
+#define MAXCPU 16
+#endif
+#if defined(HOST) && defined(HOST_SMP)
+/* Each thread of the program is a processor, see host/rcubench.c.  */
+extern __thread int hostCpu;
+#define cpuId() hostCpu
+#elif defined(HOST)
+#define cpuId() 0
+#else
+#define cpuId() ((int) getPRID())
+#endif
+
+#endif
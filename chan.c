@@ -0,0 +1,175 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* chan.c --- Bounded message channels between processes.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include "chan.h"
+
+
+/* Free slots are kept as runs of consecutive slots of CHAN_SLOTS, sorted
+ * by position: run i starts at FREE_AT[i] and is FREE_LEN[i] slots long.
+ * A freed run is merged with its free neighbours, so that there are never
+ * more runs than slots. */
+static void *CHAN_SLOTS[MAXCHANSLOTS];
+static int FREE_AT[MAXCHANSLOTS];
+static int FREE_LEN[MAXCHANSLOTS];
+static int nFree;
+
+
+void initChanPool(void) {
+    FREE_AT[0] = 0;
+    FREE_LEN[0] = MAXCHANSLOTS;
+    nFree = 1;
+}
+
+
+/* First fit: take the slots from the start of the first run long
+ * enough.  Return the index of the first slot, or -1. */
+static int slotsAlloc(int n) {
+    int at, i;
+
+    for (i = 0; i < nFree && FREE_LEN[i] < n; ++i)
+        ;
+    if (i == nFree)
+        return -1;
+
+    at = FREE_AT[i];
+    FREE_AT[i] += n;
+    FREE_LEN[i] -= n;
+    if (FREE_LEN[i] == 0) {
+        for (--nFree; i < nFree; ++i) {
+            FREE_AT[i] = FREE_AT[i + 1];
+            FREE_LEN[i] = FREE_LEN[i + 1];
+        }
+    }
+    return at;
+}
+
+
+static void slotsFree(int at, int n) {
+    int i, j;
+
+    for (i = 0; i < nFree && FREE_AT[i] < at; ++i)
+        ;
+
+    if (i > 0 && FREE_AT[i - 1] + FREE_LEN[i - 1] == at) {
+        FREE_LEN[i - 1] += n;
+        if (i < nFree && at + n == FREE_AT[i]) {
+            FREE_LEN[i - 1] += FREE_LEN[i];
+            for (--nFree; i < nFree; ++i) {
+                FREE_AT[i] = FREE_AT[i + 1];
+                FREE_LEN[i] = FREE_LEN[i + 1];
+            }
+        }
+    }
+    else if (i < nFree && at + n == FREE_AT[i]) {
+        FREE_AT[i] = at;
+        FREE_LEN[i] += n;
+    }
+    else {
+        for (j = nFree++; j > i; --j) {
+            FREE_AT[j] = FREE_AT[j - 1];
+            FREE_LEN[j] = FREE_LEN[j - 1];
+        }
+        FREE_AT[i] = at;
+        FREE_LEN[i] = n;
+    }
+}
+
+
+int initChan(chan_t *c, int cap) {
+    int at;
+
+    if (c == NULL || cap <= 0 || (at = slotsAlloc(cap)) < 0)
+        return 0;
+
+    initSemDEmbed(&c->c_sendQ, 0);
+    initSemDEmbed(&c->c_recvQ, 0);
+
+    c->c_buf = &CHAN_SLOTS[at];
+    c->c_cap = cap;
+    c->c_head = 0;
+    c->c_count = 0;
+    return 1;
+}
+
+
+/* Waiters still hold on to the channel: nothing is freed until they
+ * are gone. */
+int freeChan(chan_t *c) {
+    if (c == NULL || c->c_buf == NULL ||
+        headBlocked(&c->c_sendQ) != NULL || headBlocked(&c->c_recvQ) != NULL)
+        return 0;
+
+    freeSemD(&c->c_sendQ);
+    freeSemD(&c->c_recvQ);
+    slotsFree(c->c_buf - CHAN_SLOTS, c->c_cap);
+    c->c_buf = NULL;
+    return 1;
+}
+
+
+/* Copy the message pointers into the free slots, then wake one receiver
+ * per message sent. */
+int chanSendN(chan_t *c, pcb_t *p, void **msgs, int n, pcbq_t **rq) {
+    int sent;
+    int tail;
+
+    if (c == NULL || p == NULL || msgs == NULL || n <= 0)
+        return 0;
+
+    if (c->c_count == c->c_cap) {
+        insertBlocked(&c->c_sendQ, p);
+        return 0;
+    }
+
+    tail = (c->c_head + c->c_count) % c->c_cap;
+    for (sent = 0; sent < n && c->c_count < c->c_cap; ++sent) {
+        c->c_buf[tail] = msgs[sent];
+        tail = (tail + 1) % c->c_cap;
+        ++c->c_count;
+    }
+
+    moveBlockedN(&c->c_recvQ, rq, sent);
+    return sent;
+}
+
+
+/* Symmetric to chanSendN: take the oldest messages, then wake one sender
+ * per slot freed. */
+int chanRecvN(chan_t *c, pcb_t *p, void **msgs, int n, pcbq_t **rq) {
+    int got;
+
+    if (c == NULL || p == NULL || msgs == NULL || n <= 0)
+        return 0;
+
+    if (c->c_count == 0) {
+        insertBlocked(&c->c_recvQ, p);
+        return 0;
+    }
+
+    for (got = 0; got < n && c->c_count > 0; ++got) {
+        msgs[got] = c->c_buf[c->c_head];
+        c->c_head = (c->c_head + 1) % c->c_cap;
+        --c->c_count;
+    }
+
+    moveBlockedN(&c->c_sendQ, rq, got);
+    return got;
+}
+
+
+int chanSend(chan_t *c, pcb_t *p, void *msg, pcbq_t **rq) {
+    return chanSendN(c, p, &msg, 1, rq);
+}
+
+
+int chanRecv(chan_t *c, pcb_t *p, void **msg, pcbq_t **rq) {
+    return chanRecvN(c, p, msg, 1, rq);
+}
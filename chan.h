@@ -0,0 +1,67 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* chan.h --- Bounded message channels between processes.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef CHAN_H
+#define CHAN_H
+
+#include "proc.h"
+#include "sema.h"
+
+/* Total number of message slots shared by all the channels.  */
+#define MAXCHANSLOTS 256
+
+/* A channel is a ring of message pointers: messages are never copied, the
+   receiver gets the very pointer that was sent.
+
+   A process that cannot send (the channel is full) or receive (it is
+   empty) anything is blocked on the channel and the call returns 0; the
+   caller must schedule another process, and the blocked one retries its
+   call once it is woken.  */
+typedef struct chan {
+    void  **c_buf;		/* c_cap slots taken from the slot pool.  */
+    int     c_cap;
+    int     c_head;		/* Slot of the oldest message.  */
+    int     c_count;		/* Number of messages in the channel.  */
+    semd_t  c_sendQ;		/* Senders waiting for room.  */
+    semd_t  c_recvQ;		/* Receivers waiting for messages.  */
+} chan_t;
+
+/* Give every slot back to the slot pool.  Channels created before are no
+   longer valid.  */
+void initChanPool (void);
+
+/* Initialize the channel `c' to hold at most `cap' messages.  Return
+   FALSE if there are not `cap' consecutive free slots left.  */
+int initChan (chan_t *c, int cap);
+
+/* Mark the semaphores of the channel `c' free and give its slots back to
+   the pool.  Return FALSE, and change nothing, if processes are blocked
+   on `c' or it is not in use.  */
+int freeChan (chan_t *c);
+
+/* Send the `n' messages of `msgs' in order, as many as there is room for,
+   on behalf of the process `p'.  Up to that many waiting receivers are
+   woken with a single wakeup and inserted at the tail of the process queue
+   `rq'.  Return the number of messages sent; if it is 0, `p' is blocked
+   until there is room.  */
+int chanSendN (chan_t *c, pcb_t *p, void **msgs, int n, pcbq_t **rq);
+
+/* Receive up to `n' messages into `msgs', in the order they were sent, on
+   behalf of the process `p'.  Up to that many waiting senders are woken
+   and inserted at the tail of `rq'.  Return the number of messages
+   received; if it is 0, `p' is blocked until a message arrives.  */
+int chanRecvN (chan_t *c, pcb_t *p, void **msgs, int n, pcbq_t **rq);
+
+/* Send or receive a single message.  */
+int chanSend (chan_t *c, pcb_t *p, void *msg, pcbq_t **rq);
+int chanRecv (chan_t *c, pcb_t *p, void **msg, pcbq_t **rq);
+
+#endif
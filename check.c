@@ -0,0 +1,59 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* check.c --- Consistency checks of the kernel data structures.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include "proc.h"
+#include "sema.h"
+#include "check.h"
+
+#ifdef VALIDATE
+
+#ifdef HOST
+#include <stdlib.h>
+#define PANIC() abort()
+#else
+#include "umps/libumps.h"
+#endif
+
+static int checkFatal = 1;
+static int checkCount;
+static const char *checkLast;
+
+
+void checkFail(const char *what) {
+    ++checkCount;
+    checkLast = what;
+    if (checkFatal)
+        PANIC();
+}
+
+
+void checkSetFatal(int fatal) {
+    checkFatal = fatal;
+}
+
+
+int checkFailures(void) {
+    return checkCount;
+}
+
+
+const char *checkLastFailure(void) {
+    return checkLast;
+}
+
+
+/* Each module keeps its own cursor. */
+void checkSweep(void) {
+    procCheckStep(CHECK_SWEEP);
+    semaCheckStep(CHECK_SWEEP);
+}
+
+#endif
@@ -0,0 +1,54 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* check.h --- Consistency checks of the kernel data structures.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef CHECK_H
+#define CHECK_H
+
+/* When compiled with -DVALIDATE, every operation of proc.c and sema.c
+   checks, in constant time, the few links and states it touches, and
+   checkSweep checks a bounded number of other objects.  Without it, all
+   of this compiles to nothing.  */
+
+/* Number of pcb's and of semaphores looked at by one checkSweep.  */
+#ifndef CHECK_SWEEP
+#define CHECK_SWEEP 4
+#endif
+
+#ifdef VALIDATE
+
+/* Report `what' as a failed check if `cond' is FALSE.  */
+#define CHECK(cond, what) ((cond) ? (void) 0 : checkFail(what))
+
+/* Count the failed check `what' and, unless checkSetFatal(FALSE) was
+   called, stop the machine.  */
+void checkFail (const char *what);
+
+/* Choose whether a failed check stops the machine (the default).  */
+void checkSetFatal (int fatal);
+
+/* Return the number of failed checks, and the last one, or NULL.  */
+int checkFailures (void);
+const char *checkLastFailure (void);
+
+/* Check the next CHECK_SWEEP pcb's and semaphores in use, resuming
+   where the previous call stopped, so that every object is checked
+   again after a number of calls proportional to MAXPROC.  Meant to be
+   called on every kernel entry.  */
+void checkSweep (void);
+
+#else
+
+#define CHECK(cond, what) ((void) 0)
+#define checkSweep() ((void) 0)
+
+#endif
+
+#endif
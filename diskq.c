@@ -0,0 +1,252 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* diskq.c --- Request queues for disk and tape devices.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include "umps/arch.h"
+
+#include "diskq.h"
+
+
+/* Requests come from the free list first, then from the never used
+ * IOREQ_POOL[reqBump..MAXIOREQ-1], like pcb's. */
+static ioreq_t IOREQ_POOL[MAXIOREQ];
+static ioreq_t *reqFree;
+static int reqBump;
+
+
+void initIOReq(void) {
+    reqFree = NULL;
+    reqBump = 0;
+}
+
+
+static ioreq_t *reqAlloc(void) {
+    ioreq_t *r;
+
+    if (reqFree != NULL) {
+        r = reqFree;
+        reqFree = r->r_next;
+    }
+    else if (reqBump < MAXIOREQ) {
+        r = &IOREQ_POOL[reqBump++];
+    }
+    else {
+        return NULL;
+    }
+
+    r->r_next = NULL;
+    r->r_riders = NULL;
+    return r;
+}
+
+
+static void reqFreeOne(ioreq_t *r) {
+    r->r_next = reqFree;
+    reqFree = r;
+}
+
+
+int initDiskQ(diskq_t *dq, int line, int dev, enum dq_policy policy) {
+    if (dq == NULL || (line != IL_DISK && line != IL_TAPE))
+        return 0;
+
+    dq->dq_sem = getDevSemD(line, dev, 0);
+    if (dq->dq_sem == NULL)
+        return 0;
+
+    dq->dq_policy = policy;
+    dq->dq_pending = NULL;
+    dq->dq_active = NULL;
+    dq->dq_cyl = 0;
+    dq->dq_stats.ds_requests = 0;
+    dq->dq_stats.ds_transfers = 0;
+    dq->dq_stats.ds_merged = 0;
+    dq->dq_stats.ds_seekDist = 0;
+    return 1;
+}
+
+
+/* Order of the C-SCAN queue. */
+static int reqBefore(ioreq_t *a, ioreq_t *b) {
+    if (a->r_cyl != b->r_cyl)
+        return a->r_cyl < b->r_cyl;
+    if (a->r_head != b->r_head)
+        return a->r_head < b->r_head;
+    return a->r_sect < b->r_sect;
+}
+
+
+/* Merge r into the pending request m if they go the same way and their
+ * sectors are adjacent on the same track.  Return TRUE if r was
+ * merged. */
+static int reqMerge(ioreq_t *m, ioreq_t *r) {
+    if (m == NULL || m->r_write != r->r_write || m->r_cyl != r->r_cyl ||
+        m->r_head != r->r_head)
+        return 0;
+
+    if (m->r_sect + m->r_count == r->r_sect) {
+        m->r_count += r->r_count;
+    }
+    else if (r->r_sect + r->r_count == m->r_sect) {
+        m->r_sect = r->r_sect;
+        m->r_count += r->r_count;
+    }
+    else {
+        return 0;
+    }
+
+    r->r_next = m->r_riders;
+    m->r_riders = r;
+    return 1;
+}
+
+
+/* Insert r in the pending list, at its tail with DQ_FIFO, and in order,
+ * merging it with a neighbour if possible, with DQ_CSCAN. */
+int diskSubmit(diskq_t *dq, pcb_t *p, int cyl, int head, int sect,
+               int count, int write, void *buf) {
+    ioreq_t *r;
+    ioreq_t *prev = NULL;
+    ioreq_t *curr;
+
+    if (dq == NULL || p == NULL || count <= 0 || (r = reqAlloc()) == NULL)
+        return 0;
+
+    r->r_proc = p;
+    r->r_cyl = cyl;
+    r->r_head = head;
+    r->r_sect = sect;
+    r->r_count = count;
+    r->r_write = write;
+    r->r_buf = buf;
+    r->r_bufSect = sect;
+    r->r_bufCount = count;
+
+    curr = dq->dq_pending;
+    if (dq->dq_policy == DQ_FIFO) {
+        while (curr != NULL) {
+            prev = curr;
+            curr = curr->r_next;
+        }
+    }
+    else {
+        while (curr != NULL && reqBefore(curr, r)) {
+            prev = curr;
+            curr = curr->r_next;
+        }
+    }
+
+    if (dq->dq_policy == DQ_CSCAN && (reqMerge(prev, r) || reqMerge(curr, r))) {
+        ++dq->dq_stats.ds_merged;
+    }
+    else {
+        r->r_next = curr;
+        if (prev == NULL)
+            dq->dq_pending = r;
+        else
+            prev->r_next = r;
+    }
+
+    insertBlocked(dq->dq_sem, p);
+    return 1;
+}
+
+
+/* With DQ_CSCAN, take the first request at or after the current
+ * cylinder, or the first one of all if the arm has to come back. */
+ioreq_t *diskStart(diskq_t *dq) {
+    ioreq_t *prev = NULL;
+    ioreq_t *curr;
+
+    if (dq == NULL || dq->dq_active != NULL || dq->dq_pending == NULL)
+        return NULL;
+
+    curr = dq->dq_pending;
+    if (dq->dq_policy == DQ_CSCAN) {
+        while (curr != NULL && curr->r_cyl < dq->dq_cyl) {
+            prev = curr;
+            curr = curr->r_next;
+        }
+        if (curr == NULL) {
+            prev = NULL;
+            curr = dq->dq_pending;
+        }
+    }
+
+    if (prev == NULL)
+        dq->dq_pending = curr->r_next;
+    else
+        prev->r_next = curr->r_next;
+    curr->r_next = NULL;
+
+    if (curr->r_cyl > dq->dq_cyl)
+        dq->dq_stats.ds_seekDist += curr->r_cyl - dq->dq_cyl;
+    else
+        dq->dq_stats.ds_seekDist += dq->dq_cyl - curr->r_cyl;
+    dq->dq_cyl = curr->r_cyl;
+
+    ++dq->dq_stats.ds_transfers;
+    dq->dq_active = curr;
+    return curr;
+}
+
+
+/* The sectors of r are those of its own buffer, then those of its
+ * riders. */
+char *diskBuffer(ioreq_t *r, int i) {
+    ioreq_t *q;
+    int s;
+
+    if (r == NULL || i < 0 || i >= r->r_count)
+        return NULL;
+
+    s = r->r_sect + i;
+    for (q = r; q != NULL; q = q == r ? r->r_riders : q->r_next)
+        if (s >= q->r_bufSect && s < q->r_bufSect + q->r_bufCount)
+            return q->r_buf == NULL ? NULL :
+                q->r_buf + (s - q->r_bufSect) * DISK_SECTSIZE;
+    return NULL;
+}
+
+
+/* Wake the requester of the active transfer and of every request merged
+ * into it, then give the requests back. */
+int diskDone(diskq_t *dq, pcbq_t **rq) {
+    ioreq_t *r;
+    ioreq_t *next;
+    int n = 0;
+
+    if (dq == NULL || dq->dq_active == NULL)
+        return 0;
+
+    r = dq->dq_active;
+    dq->dq_active = NULL;
+    next = r->r_riders;
+    while (r != NULL) {
+        if (outBlocked(r->r_proc) != NULL) {
+            insertProcQ(rq, r->r_proc);
+            ++n;
+        }
+        ++dq->dq_stats.ds_requests;
+        reqFreeOne(r);
+
+        r = next;
+        if (r != NULL)
+            next = r->r_next;
+    }
+
+    return n;
+}
+
+
+void diskStats(diskq_t *dq, diskstats_t *out) {
+    if (dq != NULL && out != NULL)
+        *out = dq->dq_stats;
+}
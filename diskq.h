@@ -0,0 +1,102 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* diskq.h --- Request queues for disk and tape devices.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef DISKQ_H
+#define DISKQ_H
+
+#include "proc.h"
+#include "sema.h"
+
+/* Maximum number of requests pending on all the devices together.  Every
+   requester waits for its transfer, so one per process is enough.  */
+#define MAXIOREQ MAXPROC
+
+/* DQ_CSCAN serves pending requests by increasing cylinder from the
+   current one, then starts again from the lowest; adjacent requests are
+   merged.  DQ_FIFO serves them in arrival order, without merging.  */
+enum dq_policy { DQ_FIFO, DQ_CSCAN };
+
+/* Size of a sector, and of a tape block.  */
+#define DISK_SECTSIZE 4096
+
+/* A transfer of `r_count' consecutive sectors.  Requests merged into it
+   are chained on `r_riders' and completed with it: they go in the same
+   direction, and each keeps the sectors of its own buffer in `r_bufSect'
+   and `r_bufCount' (see diskBuffer).  On a tape, use cylinder and head 0
+   and the block number as the sector.  */
+typedef struct ioreq {
+    struct ioreq *r_next;	/* Next pending request.  */
+    struct ioreq *r_riders;	/* Requests merged into this one.  */
+    pcb_t *r_proc;		/* Process waiting for the transfer.  */
+    int    r_cyl;
+    int    r_head;
+    int    r_sect;
+    int    r_count;
+    int    r_write;		/* TRUE from memory to the device.  */
+    char  *r_buf;		/* Memory of the requester, or NULL.  */
+    int    r_bufSect;
+    int    r_bufCount;
+} ioreq_t;
+
+typedef struct diskstats {
+    unsigned int ds_requests;	/* Requests completed.  */
+    unsigned int ds_transfers;	/* Transfers started.  */
+    unsigned int ds_merged;	/* Requests merged into another one.  */
+    unsigned int ds_seekDist;	/* Cylinders travelled.  */
+} diskstats_t;
+
+/* Request queue of a device.  */
+typedef struct diskq {
+    enum dq_policy dq_policy;
+    semd_t  *dq_sem;		/* Device semaphore the requesters wait on.  */
+    ioreq_t *dq_pending;	/* Sorted by (cylinder, head, sector) with
+				   DQ_CSCAN, by arrival with DQ_FIFO.  */
+    ioreq_t *dq_active;		/* Transfer in progress, or NULL.  */
+    int      dq_cyl;		/* Current cylinder of the arm.  */
+    diskstats_t dq_stats;
+} diskq_t;
+
+/* Give every request back to the request pool.  */
+void initIOReq (void);
+
+/* Initialize the request queue `dq' of the device `dev' on the interrupt
+   line `line' (IL_DISK or IL_TAPE).  Return FALSE if there is no such
+   device.  */
+int initDiskQ (diskq_t *dq, int line, int dev, enum dq_policy policy);
+
+/* Queue a transfer of `count' sectors from (`cyl', `head', `sect') for the
+   process `p', to the device if `write' is TRUE and from it otherwise,
+   and block `p' on the device semaphore until it completes.  `buf' is
+   the memory of the sectors, or NULL if the caller tells the driver
+   another way.  A read and a write are never merged.  Return FALSE if no
+   request is left.  */
+int diskSubmit (diskq_t *dq, pcb_t *p, int cyl, int head, int sect,
+                int count, int write, void *buf);
+
+/* Choose the next transfer, take it out of the pending requests and return
+   it, so that the caller can program the device.  Return NULL if a
+   transfer is already in progress or nothing is pending.  */
+ioreq_t *diskStart (diskq_t *dq);
+
+/* Return the memory of the sector `i' of the transfer `r', from the
+   buffer of the request it belongs to, or NULL if that request has
+   none.  */
+char *diskBuffer (ioreq_t *r, int i);
+
+/* Complete the transfer in progress: every process waiting for it is
+   woken and inserted at the tail of the process queue `rq'.  Return the
+   number of processes woken.  */
+int diskDone (diskq_t *dq, pcbq_t **rq);
+
+/* Copy the statistics of `dq' into `out'.  */
+void diskStats (diskq_t *dq, diskstats_t *out);
+
+#endif
@@ -0,0 +1,189 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* edf.c --- Earliest-deadline-first scheduling class.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include "edf.h"
+#include "tod.h"
+
+
+/* Binary min-heap of processes ordered by deadline.  Each process
+ * remembers its index, so it can be removed without searching. */
+static pcb_t *EDF_HEAP[MAXPROC];
+static int heapSize;
+
+static edfstats_t stats;
+
+
+/* Deadlines are compared as differences, so that a TOD wrap-around
+ * does not reorder them. */
+#define before(a, b) ((int) ((a) - (b)) < 0)
+#define deadline(i)  (getPEdf(EDF_HEAP[i])->e_deadline)
+
+
+void initEDF(void) {
+    addFreeHook(edfLeave);
+    heapSize = 0;
+    stats.es_jobs = 0;
+    stats.es_misses = 0;
+    stats.es_totalLate = 0;
+    stats.es_maxLate = 0;
+    stats.es_util = 0;
+}
+
+
+static void heapSet(int i, pcb_t *p) {
+    EDF_HEAP[i] = p;
+    getPEdf(p)->e_idx = i;
+}
+
+
+/* Move the process at index i up until its parent is not later. */
+static void siftUp(int i) {
+    pcb_t *p = EDF_HEAP[i];
+    unsigned int d = getPEdf(p)->e_deadline;
+
+    while (i > 0 && before(d, deadline((i - 1) / 2))) {
+        heapSet(i, EDF_HEAP[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    heapSet(i, p);
+}
+
+
+/* Move the process at index i down until no child is earlier. */
+static void siftDown(int i) {
+    pcb_t *p = EDF_HEAP[i];
+    unsigned int d = getPEdf(p)->e_deadline;
+    int c;
+
+    while ((c = 2 * i + 1) < heapSize) {
+        if (c + 1 < heapSize && before(deadline(c + 1), deadline(c)))
+            ++c;
+        if (!before(deadline(c), d))
+            break;
+        heapSet(i, EDF_HEAP[c]);
+        i = c;
+    }
+    heapSet(i, p);
+}
+
+
+/* Return r * EDF_UTIL_ONE / period for r < period, one bit at a time
+ * by long division, so that no intermediate result overflows. */
+static unsigned int utilFrac(unsigned int r, unsigned int period) {
+    unsigned int q = 0;
+    int i;
+
+    for (i = EDF_UTIL_ONE; i > 1; i /= 2) {
+        q *= 2;
+        if (r >= period - r) {
+            r -= period - r;
+            ++q;
+        }
+        else
+            r += r;
+    }
+    return q;
+}
+
+
+/* Utilization is the sum of cost/period of the admitted processes. */
+int edfAdmit(pcb_t *p, unsigned int cost, unsigned int period) {
+    unsigned int util;
+
+    if (p == NULL || period == 0 || cost > period || getPEdf(p)->e_util != 0)
+        return 0;
+
+    util = cost / period * EDF_UTIL_ONE + utilFrac(cost % period, period);
+    if (util == 0)
+        util = 1;
+    if (stats.es_util + util > EDF_UTIL_ONE)
+        return 0;
+
+    stats.es_util += util;
+    getPEdf(p)->e_util = util;
+    return 1;
+}
+
+
+void edfLeave(pcb_t *p) {
+    if (p == NULL)
+        return;
+
+    edfOut(p);
+    stats.es_util -= getPEdf(p)->e_util;
+    getPEdf(p)->e_util = 0;
+}
+
+
+void edfInsert(pcb_t *p, unsigned int deadline) {
+    if (p == NULL || getPEdf(p)->e_util == 0 || getPEdf(p)->e_idx >= 0)
+        return;
+
+    getPEdf(p)->e_deadline = deadline;
+    EDF_HEAP[heapSize] = p;
+    siftUp(heapSize++);
+}
+
+
+pcb_t *edfRemoveMin(void) {
+    return heapSize == 0 ? NULL : edfOut(EDF_HEAP[0]);
+}
+
+
+/* Fill p's slot with the last process of the heap, and move that one
+ * up or down to restore the heap order. */
+pcb_t *edfOut(pcb_t *p) {
+    int i;
+
+    if (p == NULL || (i = getPEdf(p)->e_idx) < 0)
+        return NULL;
+
+    getPEdf(p)->e_idx = -1;
+    if (i != --heapSize) {
+        heapSet(i, EDF_HEAP[heapSize]);
+        if (i > 0 && before(deadline(i), deadline((i - 1) / 2)))
+            siftUp(i);
+        else
+            siftDown(i);
+    }
+    return p;
+}
+
+
+pcb_t *edfHead(void) {
+    return heapSize == 0 ? NULL : EDF_HEAP[0];
+}
+
+
+void edfComplete(pcb_t *p) {
+    unsigned int late;
+
+    if (p == NULL)
+        return;
+
+    ++stats.es_jobs;
+    late = readTOD() - getPEdf(p)->e_deadline;
+    if ((int) late > 0) {
+        ++stats.es_misses;
+        stats.es_totalLate += late;
+        if (late > stats.es_maxLate)
+            stats.es_maxLate = late;
+    }
+}
+
+
+void edfStats(edfstats_t *out) {
+    if (out == NULL)
+        return;
+
+    *out = stats;
+    out->es_ready = heapSize;
+}
@@ -0,0 +1,71 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* edf.h --- Earliest-deadline-first scheduling class.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef EDF_H
+#define EDF_H
+
+#include "proc.h"
+
+/* Utilizations are fixed point numbers: EDF_UTIL_ONE is a whole CPU.  */
+#define EDF_UTIL_ONE 1024
+
+/* EDF fields embedded in every process, see getPEdf.  */
+struct edfnode {
+    unsigned int e_deadline;	/* Absolute deadline, in TOD ticks.  */
+    unsigned int e_util;	/* Admitted utilization, or 0.  */
+    int          e_idx;		/* Index in the EDF heap, or -1.  */
+};
+
+typedef struct edfstats {
+    unsigned int es_jobs;	/* Jobs completed.  */
+    unsigned int es_misses;	/* Jobs completed after their deadline.  */
+    unsigned int es_totalLate;	/* Sum of the lateness of missed jobs.  */
+    unsigned int es_maxLate;	/* Worst lateness of a job.  */
+    unsigned int es_util;	/* Utilization admitted so far.  */
+    int          es_ready;	/* Processes in the EDF queue.  */
+} edfstats_t;
+
+/* Initialize the EDF class: no process is admitted nor queued.  Call it
+   after initProc.  */
+void initEDF (void);
+
+/* Admit the process `p', which runs for at most `cost' ticks every
+   `period' ticks, in the EDF class.  Return FALSE, and leave `p' out, if
+   the total utilization would exceed one CPU.  */
+int edfAdmit (pcb_t *p, unsigned int cost, unsigned int period);
+
+/* Remove the process `p' from the EDF class and from the EDF queue.
+   freePcb does it for the processes it frees (see addFreeHook).  */
+void edfLeave (pcb_t *p);
+
+/* Insert the admitted process `p' in the EDF queue with the absolute
+   deadline `deadline'.  O(log n).  */
+void edfInsert (pcb_t *p, unsigned int deadline);
+
+/* Remove and return the process with the earliest deadline, or NULL if
+   the EDF queue is empty.  O(log n).  */
+pcb_t *edfRemoveMin (void);
+
+/* Remove the process `p' from the EDF queue.  Return NULL if it was not
+   in it, and `p' otherwise.  O(log n).  */
+pcb_t *edfOut (pcb_t *p);
+
+/* Return the process with the earliest deadline without removing it.  */
+pcb_t *edfHead (void);
+
+/* Record that the current job of `p' has completed, comparing its
+   deadline with the TOD clock.  */
+void edfComplete (pcb_t *p);
+
+/* Copy the EDF statistics into `out'.  */
+void edfStats (edfstats_t *out);
+
+#endif
@@ -0,0 +1,28 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* hist.c --- Log-scale histograms.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include "hist.h"
+
+
+/* The bucket of v is the position of its highest set bit. */
+int histBucket(unsigned int v) {
+    int b = 0;
+
+    while (v >>= 1)
+        ++b;
+
+    return b;
+}
+
+
+void histAdd(unsigned int *h, unsigned int v) {
+    ++h[histBucket(v)];
+}
@@ -0,0 +1,25 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* hist.h --- Log-scale histograms.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef HIST_H
+#define HIST_H
+
+/* One bucket per power of two of an unsigned int.  */
+#define HIST_BUCKETS 32
+
+/* Count the value `v' in the histogram `h': bucket i counts the values in
+   [2^i, 2^(i+1)), and bucket 0 also counts 0.  */
+void histAdd (unsigned int *h, unsigned int v);
+
+/* Return the bucket in which `v' is counted.  */
+int histBucket (unsigned int v);
+
+#endif
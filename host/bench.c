@@ -0,0 +1,127 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* bench.c --- Ping-pong and producer/consumer benchmarks of the green
+   thread runtime.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "green.h"
+
+#define BUFSIZE 8
+
+static long rounds;
+
+static semd_t *ping, *pong;
+
+static semd_t *slots, *items, *mutex;
+static int buffer[BUFSIZE];
+static int in, out;
+static long produced, consumed;
+
+
+static void pinger(void *arg) {
+    long i;
+
+    for (i = 0; i < rounds; ++i) {
+        greenP(ping);
+        greenV(pong);
+    }
+}
+
+
+static void ponger(void *arg) {
+    long i;
+
+    for (i = 0; i < rounds; ++i) {
+        greenV(ping);
+        greenP(pong);
+    }
+}
+
+
+static void producer(void *arg) {
+    long n = (long) arg;
+    long i;
+
+    for (i = 0; i < n; ++i) {
+        greenP(slots);
+        greenP(mutex);
+        buffer[in] = (int) i;
+        in = (in + 1) % BUFSIZE;
+        ++produced;
+        greenV(mutex);
+        greenV(items);
+    }
+}
+
+
+static void consumer(void *arg) {
+    long n = (long) arg;
+    long i;
+
+    for (i = 0; i < n; ++i) {
+        greenP(items);
+        greenP(mutex);
+        out = (out + 1) % BUFSIZE;
+        ++consumed;
+        greenV(mutex);
+        greenV(slots);
+    }
+}
+
+
+/* Print what greenRun did in the time since `start'. */
+static void report(const char *name, double start, int blocked) {
+    greenstats_t st;
+    double secs = (greenNow() - start) / 1e9;
+
+    greenStats(&st);
+    printf("%-18s %10lu switches %12.0f switches/s  "
+           "wakeup avg %7.0f ns max %8.0f ns%s\n",
+           name, st.gs_switches, st.gs_switches / secs,
+           st.gs_wakeups ? st.gs_wakeTotal / st.gs_wakeups : 0.0,
+           st.gs_wakeMax, blocked ? "  DEADLOCK" : "");
+}
+
+
+int main(int argc, char **argv) {
+    double start;
+    int pairs = 4;
+    int i;
+    int blocked;
+
+    rounds = argc > 1 ? atol(argv[1]) : 200000;
+
+    greenInit();
+    ping = greenSem(0);
+    pong = greenSem(0);
+    greenSpawn(pinger, NULL);
+    greenSpawn(ponger, NULL);
+    start = greenNow();
+    blocked = greenRun();
+    report("ping-pong", start, blocked);
+
+    greenInit();
+    slots = greenSem(BUFSIZE);
+    items = greenSem(0);
+    mutex = greenSem(1);
+    in = out = 0;
+    produced = consumed = 0;
+    for (i = 0; i < pairs; ++i) {
+        greenSpawn(producer, (void *) (rounds / pairs));
+        greenSpawn(consumer, (void *) (rounds / pairs));
+    }
+    start = greenNow();
+    blocked = greenRun();
+    report("producer/consumer", start, blocked);
+
+    return produced != consumed || blocked;
+}
@@ -0,0 +1,158 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* cowbench.c --- Compare copy-on-write and eager copying of the address
+   space on a fork.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "proc.h"
+#include "page.h"
+#include "as.h"
+
+/* Pages of the parent: all of its address space.  */
+#define PAGES   AS_NPTE
+#define FRAMES  (4 * PAGES)
+
+static unsigned int vaddrs[PAGES];
+
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+unsigned int hostTOD(void) {
+    return (unsigned int) (now() / 1000);
+}
+
+
+static int framesUsed(void) {
+    pagestats_t ps;
+
+    pageStats(&ps);
+    return ps.ps_total - ps.ps_free - ps.ps_cached;
+}
+
+
+/* The child gets its copy of every page at once, copied a word at a
+ * time as asWriteFault does. */
+static void forkEager(aspace_t *parent, aspace_t *child) {
+    unsigned int *d, *s;
+    unsigned int f;
+    int i, j;
+
+    for (i = 0; i < PAGES; ++i) {
+        f = allocPage();
+        d = (unsigned int *) (unsigned long) f;
+        s = (unsigned int *) (unsigned long)
+            (asEntryLo(parent, vaddrs[i]) & AS_PFN_MASK);
+        for (j = 0; j < PAGESIZE / (int) sizeof(*d); ++j)
+            d[j] = s[j];
+        asMap(child, vaddrs[i], f, 1);
+    }
+}
+
+
+/* A write by the child, through the TLB handler when the page is shared. */
+static void childWrite(aspace_t *child, int i) {
+    unsigned int lo = asEntryLo(child, vaddrs[i]);
+
+    if (lo & AS_COW) {
+        asWriteFault(child, vaddrs[i]);
+        lo = asEntryLo(child, vaddrs[i]);
+    }
+    *(unsigned int *) (unsigned long) (lo & AS_PFN_MASK) = i;
+}
+
+
+/* Fork `n' children of a parent with PAGES pages, each writing `writes'
+ * pages then exiting, and print the mean time of a fork and exit and
+ * the frames used while the child is alive. */
+static void run(const char *name, int cow, int writes, int n) {
+    pcb_t *parent, *child;
+    aspace_t *as;
+    unsigned int f;
+    double start, elapsed;
+    int peak = 0;
+    int i, k;
+
+    initProc();
+    initAS();
+    parent = allocPcb();
+    as = getPAs(parent);
+    for (i = 0; i < PAGES; ++i) {
+        f = allocPage();
+        memset((void *) (unsigned long) f, i, PAGESIZE);
+        asMap(as, vaddrs[i], f, 1);
+    }
+
+    start = now();
+    for (k = 0; k < n; ++k) {
+        child = allocPcb();
+        insertChild(parent, child);
+        if (cow)
+            asFork(as, getPAs(child));
+        else
+            forkEager(as, getPAs(child));
+        for (i = 0; i < writes; ++i)
+            childWrite(getPAs(child), i);
+        if (k == 0)
+            peak = framesUsed();
+        asFree(getPAs(child));
+        outChild(child);
+        freePcb(child);
+    }
+    elapsed = now() - start;
+
+    printf("%-5s %2d/%d pages written  %9.0f ns/fork+exit  "
+           "%3d frames used (%2d by the child)\n",
+           name, writes, PAGES, elapsed / n, peak, peak - PAGES);
+
+    asFree(as);
+    freePcb(parent);
+    drainPages();
+}
+
+
+int main(int argc, char **argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 100000;
+    int writes[] = {0, 1, PAGES / 4, PAGES};
+    void *arena;
+    unsigned int base;
+    int i;
+
+    /* Frame addresses are 32 bits, as on the machine. */
+    arena = mmap(NULL, (FRAMES + 1) * PAGESIZE, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (arena == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    base = (unsigned int) (unsigned long) arena;
+    initPages(base, FRAMES);
+
+    for (i = 0; i < PAGES - 1; ++i)
+        vaddrs[i] = AS_KUSEG_START + i * PAGESIZE;
+    vaddrs[PAGES - 1] = AS_KUSEG_STACK - PAGESIZE;
+
+    for (i = 0; i < (int) (sizeof(writes) / sizeof(*writes)); ++i) {
+        run("eager", 0, writes[i], n);
+        run("cow", 1, writes[i], n);
+    }
+    return 0;
+}
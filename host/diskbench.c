@@ -0,0 +1,134 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* diskbench.c --- Compare the FIFO and C-SCAN disk request queues on a
+   simulated disk.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "umps/arch.h"
+
+#include "proc.h"
+#include "sema.h"
+#include "diskq.h"
+
+/* Geometry and timings of the simulated disk, in microseconds.  */
+#define CYLS        1024
+#define HEADS       4
+#define SECTS       16
+#define SEEK_BASE   1000
+#define SEEK_CYL    20
+#define XFER_SECT   300
+#define XFER_BASE   100
+
+#define CLIENTS     16
+
+/* Last request of each client, so that others can ask for the sectors
+ * right after it, as processes reading the same file would. */
+static int lastCyl[CLIENTS], lastHead[CLIENTS], lastSect[CLIENTS];
+static unsigned int seed;
+static double diskTime;		/* Simulated time, in microseconds.  */
+
+
+/* The TOD clock of tod.h follows the simulated time. */
+unsigned int hostTOD(void) {
+    return (unsigned int) diskTime;
+}
+
+
+static int rnd(int n) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+
+static void submit(diskq_t *dq, pcb_t *p, int i) {
+    int j = rnd(CLIENTS);
+
+    if (rnd(10) < 3 && lastSect[j] + 1 < SECTS) {
+        lastCyl[i] = lastCyl[j];
+        lastHead[i] = lastHead[j];
+        lastSect[i] = lastSect[j] + 1;
+    }
+    else {
+        lastCyl[i] = rnd(CYLS);
+        lastHead[i] = rnd(HEADS);
+        lastSect[i] = rnd(SECTS);
+    }
+    diskSubmit(dq, p, lastCyl[i], lastHead[i], lastSect[i], 1, 0, NULL);
+}
+
+
+/* Every client keeps one request pending until it has made `per'
+ * requests.  The time of each transfer follows the disk model. */
+static void run(const char *name, enum dq_policy policy, int per) {
+    pcb_t *procs[CLIENTS];
+    int left[CLIENTS];
+    diskq_t dq;
+    diskstats_t st;
+    pcbq_t *rq = mkEmptyProcQ();
+    ioreq_t *r;
+    pacct_t acct;
+    double blocked = 0;
+    int cyl = 0;
+    int i;
+
+    initProc();
+    initASL();
+    initIOReq();
+    initDiskQ(&dq, IL_DISK, 0, policy);
+    seed = 42;
+    diskTime = 0;
+
+    for (i = 0; i < CLIENTS; ++i) {
+        procs[i] = allocPcb();
+        left[i] = per - 1;
+        lastSect[i] = SECTS;
+        submit(&dq, procs[i], i);
+    }
+
+    while ((r = diskStart(&dq)) != NULL) {
+        if (r->r_cyl != cyl)
+            diskTime += SEEK_BASE + SEEK_CYL * abs(r->r_cyl - cyl);
+        diskTime += XFER_BASE + XFER_SECT * r->r_count;
+        cyl = r->r_cyl;
+
+        diskDone(&dq, &rq);
+        while (!emptyProcQ(rq)) {
+            pcb_t *p = removeProcQ(&rq);
+
+            i = pcbIndex(p);
+            if (left[i]-- > 0)
+                submit(&dq, p, i);
+        }
+    }
+
+    for (i = 0; i < CLIENTS; ++i) {
+        getPAcct(procs[i], &acct, NULL);
+        blocked += acct.pa_blocked;
+    }
+
+    diskStats(&dq, &st);
+    printf("%-7s %7u requests %7u transfers %6u merged  "
+           "seek %9u cyl (%6.1f/transfer)  %8.1f requests/s  "
+           "wait %8.1f us/request\n",
+           name, st.ds_requests, st.ds_transfers, st.ds_merged,
+           st.ds_seekDist, (double) st.ds_seekDist / st.ds_transfers,
+           st.ds_requests / (diskTime / 1e6), blocked / st.ds_requests);
+}
+
+
+int main(int argc, char **argv) {
+    int per = argc > 1 ? atoi(argv[1]) : 2000;
+
+    run("FIFO", DQ_FIFO, per);
+    run("C-SCAN", DQ_CSCAN, per);
+    return 0;
+}
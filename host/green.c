@@ -0,0 +1,193 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* green.c --- Green threads on Linux built on the Kaya process and
+   semaphore modules.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include "green.h"
+
+#define STACK_SIZE (64 * 1024)
+
+/* Per-thread data, indexed with pcbIndex. */
+struct green {
+    ucontext_t g_ctx;
+    char      *g_stack;
+    void     (*g_fn)(void *);
+    void      *g_arg;
+    double     g_wokenAt;	/* When a V woke it, or 0.  */
+};
+
+static struct green THREADS[MAXPROC];
+
+static ucontext_t schedCtx;
+static pcbq_t *readyQ;
+static pcb_t *current;
+static int live;		/* Threads spawned and not finished.  */
+static greenstats_t stats;
+
+
+double greenNow(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+/* The TOD clock of tod.h counts microseconds. */
+unsigned int hostTOD(void) {
+    return (unsigned int) (greenNow() / 1000);
+}
+
+
+void greenInit(void) {
+    initProc();
+    initASL();
+    readyQ = mkEmptyProcQ();
+    current = NULL;
+    live = 0;
+    stats.gs_switches = 0;
+    stats.gs_wakeups = 0;
+    stats.gs_wakeTotal = 0;
+    stats.gs_wakeMax = 0;
+}
+
+
+/* First function of every thread.  When it returns, the thread goes
+ * back to greenRun through uc_link, with g_fn cleared to tell it that
+ * the thread is done. */
+static void trampoline(void) {
+    struct green *g = &THREADS[pcbIndex(current)];
+
+    g->g_fn(g->g_arg);
+    g->g_fn = NULL;
+}
+
+
+pcb_t *greenSpawn(void (*fn)(void *), void *arg) {
+    pcb_t *p = allocPcb();
+    struct green *g;
+
+    if (p == NULL)
+        return NULL;
+
+    g = &THREADS[pcbIndex(p)];
+    g->g_stack = malloc(STACK_SIZE);
+    g->g_fn = fn;
+    g->g_arg = arg;
+    g->g_wokenAt = 0;
+
+    getcontext(&g->g_ctx);
+    g->g_ctx.uc_stack.ss_sp = g->g_stack;
+    g->g_ctx.uc_stack.ss_size = STACK_SIZE;
+    g->g_ctx.uc_link = &schedCtx;
+    makecontext(&g->g_ctx, trampoline, 0);
+
+    if (current != NULL)
+        insertChild(current, p);
+    insertProcQ(&readyQ, p);
+    ++live;
+    return p;
+}
+
+
+/* Switch to the ready threads in FIFO order.  A thread comes back here
+ * when it yields, blocks or returns. */
+int greenRun(void) {
+    struct green *g;
+    pcb_t *p;
+
+    while ((p = removeProcQ(&readyQ)) != NULL) {
+        g = &THREADS[pcbIndex(p)];
+        current = p;
+        setPState(p, PS_RUNNING);
+        ++stats.gs_switches;
+
+        if (g->g_wokenAt != 0) {
+            double lat = greenNow() - g->g_wokenAt;
+
+            stats.gs_wakeTotal += lat;
+            if (lat > stats.gs_wakeMax)
+                stats.gs_wakeMax = lat;
+            g->g_wokenAt = 0;
+        }
+
+        if (swapcontext(&schedCtx, &g->g_ctx) != 0) {
+            perror("swapcontext");
+            exit(1);
+        }
+
+        if (g->g_fn == NULL) {
+            /* Finished: see trampoline. */
+            outChild(p);
+            free(g->g_stack);
+            freePcb(p);
+            --live;
+        }
+        current = NULL;
+    }
+
+    return live;
+}
+
+
+pcb_t *greenSelf(void) {
+    return current;
+}
+
+
+/* Save the running thread and go back to greenRun. */
+static void switchOut(void) {
+    struct green *g = &THREADS[pcbIndex(current)];
+
+    swapcontext(&g->g_ctx, &schedCtx);
+}
+
+
+void greenYield(void) {
+    setPState(current, PS_READY);
+    insertProcQ(&readyQ, current);
+    switchOut();
+}
+
+
+semd_t *greenSem(int val) {
+    semd_t *s;
+
+    if (!initSemDPerm(&s, val)) {
+        fprintf(stderr, "green: no semaphore left\n");
+        exit(1);
+    }
+    return s;
+}
+
+
+void greenP(semd_t *s) {
+    if (passerenN(s, current, 1) == 0)
+        switchOut();
+}
+
+
+/* The woken thread, if any, is the new tail of readyQ. */
+void greenV(semd_t *s) {
+    if (verhogenN(s, 1, &readyQ) > 0) {
+        THREADS[pcbIndex(readyQ)].g_wokenAt = greenNow();
+        ++stats.gs_wakeups;
+    }
+}
+
+
+void greenStats(greenstats_t *out) {
+    *out = stats;
+}
@@ -0,0 +1,61 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* green.h --- Green threads on Linux built on the Kaya process and
+   semaphore modules.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef GREEN_H
+#define GREEN_H
+
+#include "proc.h"
+#include "sema.h"
+
+/* Every thread is a pcb_t with its own stack and ucontext.  Ready threads
+   wait in a pcbq_t, and threads block on semd_t's with insertBlocked;
+   nothing else keeps track of them.  */
+
+/* Reset the process and semaphore modules and the runtime.  */
+void greenInit (void);
+
+/* Create a thread running `fn(arg)'.  Return NULL if there is no PCB
+   left.  */
+pcb_t *greenSpawn (void (*fn)(void *), void *arg);
+
+/* Run the ready threads until none is left.  Return the number of
+   threads still blocked on a semaphore (0 unless they deadlocked).  */
+int greenRun (void);
+
+/* Return the running thread.  */
+pcb_t *greenSelf (void);
+
+/* Let the other ready threads run.  */
+void greenYield (void);
+
+/* Create a semaphore of initial value `val' for the threads.  */
+semd_t *greenSem (int val);
+
+/* P and V on a semaphore created with greenSem.  */
+void greenP (semd_t *s);
+void greenV (semd_t *s);
+
+/* Statistics since greenInit.  Latencies are in nanoseconds, from the V
+   that wakes a thread to the moment it runs again.  */
+typedef struct greenstats {
+    unsigned long gs_switches;	/* Context switches to a thread.  */
+    unsigned long gs_wakeups;	/* Threads woken by a V.  */
+    double        gs_wakeTotal;	/* Sum of the wakeup latencies.  */
+    double        gs_wakeMax;	/* Worst wakeup latency.  */
+} greenstats_t;
+
+void greenStats (greenstats_t *out);
+
+/* Return a monotonic time in nanoseconds.  */
+double greenNow (void);
+
+#endif
@@ -0,0 +1,193 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* rcubench.c --- Read throughput of the process tree under fork and exit
+   churn, with deferred freeing, with a tree lock, and with neither.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "proc.h"
+#include "rcu.h"
+#include "atomic.h"
+
+/* The root has PARENTS children, among which LEAVES processes are
+ * spread.  The writer makes one leaf exit and forks another at each
+ * step. */
+#define PARENTS  16
+#define LEAVES   256
+#define READERS_MAX (MAXCPU - 1)
+
+enum mode { M_IDLE, M_RCU, M_LOCK, M_UNSAFE };
+static const char *MODE_NAMES[] = {"no churn", "rcu", "tree lock", "unsafe"};
+
+__thread int hostCpu;
+
+static enum mode mode;
+static volatile int stop;
+static int treeLock;
+static pcb_t *root;
+static pcb_t *parents[PARENTS];
+static pcb_t *leaves[LEAVES];
+
+static unsigned long walks[MAXCPU];
+static unsigned long nodes[MAXCPU];
+static unsigned long stale[MAXCPU];
+static unsigned long churn;
+
+
+unsigned int hostTOD(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/* Count the processes under p, and the free ones met on the way, which
+ * a reader must never see.  A walk through reused processes may loop:
+ * it is cut short. */
+static int walk(pcb_t *p, unsigned long *bad, int budget) {
+    pcb_t *c;
+    int n = 1;
+
+    if (getPState(p) == PS_FREE)
+        ++*bad;
+    for (c = headChild(p); c != NULL && n < budget; c = nextChild(c))
+        n += walk(c, bad, budget - n);
+    return n;
+}
+
+
+static void *reader(void *arg) {
+    int cpu = (int) (long) arg;
+
+    hostCpu = cpu;
+    while (!stop) {
+        if (mode == M_LOCK)
+            spinLock(&treeLock);
+        nodes[cpu] += walk(root, &stale[cpu], MAXPROC);
+        if (mode == M_LOCK)
+            spinUnlock(&treeLock);
+        rcuQuiescent();
+        ++walks[cpu];
+    }
+    rcuOffline();
+    return NULL;
+}
+
+
+static unsigned int seed = 42;
+
+static int rnd(int n) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+
+static pcb_t *fork1(void) {
+    pcb_t *c;
+
+    while ((c = allocPcb()) == NULL) {
+        rcuQuiescent();
+        rcuReclaim();
+    }
+    return c;
+}
+
+
+/* Runs on processor 0, which holds no pointer into the tree between
+ * two steps. */
+static void *writer(void *arg) {
+    pcb_t *c;
+    int i;
+
+    hostCpu = 0;
+    while (!stop && mode != M_IDLE) {
+        i = rnd(LEAVES);
+        c = fork1();
+        if (mode == M_LOCK)
+            spinLock(&treeLock);
+        outChild(leaves[i]);
+        insertChild(parents[rnd(PARENTS)], c);
+        if (mode == M_LOCK)
+            spinUnlock(&treeLock);
+        if (mode == M_RCU)
+            rcuFreePcb(leaves[i]);
+        else
+            freePcb(leaves[i]);
+        leaves[i] = c;
+        rcuQuiescent();
+        ++churn;
+    }
+    return NULL;
+}
+
+
+static void run(enum mode m, int nreaders, double seconds) {
+    pthread_t threads[READERS_MAX + 1];
+    unsigned long w = 0, n = 0, bad = 0;
+    rcustats_t st;
+    int i;
+
+    mode = m;
+    stop = 0;
+    treeLock = 0;
+    churn = 0;
+    initProc();
+    initRCU(nreaders + 1);
+    hostCpu = 0;
+    root = allocPcb();
+    for (i = 0; i < PARENTS; ++i) {
+        parents[i] = allocPcb();
+        insertChild(root, parents[i]);
+    }
+    for (i = 0; i < LEAVES; ++i) {
+        leaves[i] = allocPcb();
+        insertChild(parents[rnd(PARENTS)], leaves[i]);
+    }
+
+    for (i = 1; i <= nreaders; ++i) {
+        walks[i] = nodes[i] = stale[i] = 0;
+        pthread_create(&threads[i], NULL, reader, (void *) (long) i);
+    }
+    pthread_create(&threads[0], NULL, writer, NULL);
+    usleep(seconds * 1e6);
+    stop = 1;
+    for (i = 0; i <= nreaders; ++i)
+        pthread_join(threads[i], NULL);
+
+    for (i = 1; i <= nreaders; ++i) {
+        w += walks[i];
+        n += nodes[i];
+        bad += stale[i];
+    }
+    rcuStats(&st);
+    printf("%-9s %2d readers  %9.0f walks/s  %6.1f M nodes/s  "
+           "%9.0f fork+exit/s  %6lu free pcbs seen  %7u grace periods\n",
+           MODE_NAMES[m], nreaders, w / seconds, n / seconds / 1e6,
+           churn / seconds, bad, st.rs_graces);
+}
+
+
+int main(int argc, char **argv) {
+    int nreaders = argc > 1 ? atoi(argv[1]) : 3;
+    double seconds = argc > 2 ? atof(argv[2]) : 1;
+
+    if (nreaders < 1 || nreaders > READERS_MAX)
+        nreaders = 3;
+    run(M_IDLE, nreaders, seconds);
+    run(M_RCU, nreaders, seconds);
+    run(M_LOCK, nreaders, seconds);
+    run(M_UNSAFE, nreaders, seconds);
+    return 0;
+}
@@ -0,0 +1,410 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* sim.c --- Discrete-event simulation of a process workload against the
+   process and semaphore modules, to measure how they scale.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+/* Usage:
+     sim                 run the synthetic workload for 10 to 100000
+                         processes and print latency percentiles
+     sim -g N            print the synthetic trace for N processes
+     sim -r FILE         replay a trace and print latency percentiles
+
+   A trace has one operation per line, "TIME OP ID ARG", in time order:
+     F parent child      fork: allocPcb and insertChild
+     X id 0              exit: kill id and all its descendants
+     P id sem            passeren on semaphore number sem
+     V id sem            verhogen on semaphore number sem
+     S id ticks          sleep; no kernel data structure is involved
+   Process 0 exists from the start.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "proc.h"
+#include "sema.h"
+#include "check.h"
+
+enum op { OP_FORK, OP_EXIT, OP_P, OP_V, OP_SLEEP, OP_N };
+static const char OPCHAR[OP_N] = { 'F', 'X', 'P', 'V', 'S' };
+static const char *OPNAME[OP_N] = { "fork", "exit", "P", "V", "sleep" };
+
+/* Latencies of each kind of operation, in nanoseconds. */
+static double *samples[OP_N];
+static long nsamples[OP_N], capsamples[OP_N];
+
+/* Simulated process and semaphore tables, indexed by trace id. */
+static pcb_t *procOf[MAXPROC];
+static int idOf[MAXPROC];		/* Trace id of each pcbIndex.  */
+static int genOf[MAXPROC];		/* Bumped when an id dies.  */
+static semd_t *sems[MAXPROC];
+static int nsems;
+
+static FILE *traceOut;
+static double simTime;		/* Time of the operation being applied.  */
+
+
+/* The TOD clock of tod.h follows the simulated time. */
+unsigned int hostTOD(void) {
+    return (unsigned int) simTime;
+}
+
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static void record(enum op op, double ns) {
+    if (nsamples[op] == capsamples[op]) {
+        capsamples[op] = capsamples[op] ? 2 * capsamples[op] : 4096;
+        samples[op] = realloc(samples[op], capsamples[op] * sizeof(double));
+    }
+    samples[op][nsamples[op]++] = ns;
+}
+
+
+static int cmpDouble(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+
+static void reset(int nsem) {
+    int i;
+
+    initProc();
+    initASL();
+    for (i = 0; i < OP_N; ++i)
+        nsamples[i] = 0;
+    for (i = 0; i < MAXPROC; ++i)
+        procOf[i] = NULL;
+
+    nsems = nsem > MAXPROC ? MAXPROC : nsem;
+    for (i = 0; i < nsems; ++i)
+        initSemDPerm(&sems[i], 0);
+
+    procOf[0] = allocPcb();
+    idOf[pcbIndex(procOf[0])] = 0;
+}
+
+
+/* Kill p and its descendants: take them off their semaphores, detach p
+ * from the tree and free them all.  pcbs of the subtree are collected
+ * first, since outChild detaches them. */
+static void killTree(pcb_t *p, pcb_t **stack, pcb_t **dead, int *ndead) {
+    pcb_t *q;
+    pcb_t *c;
+    int top = 0;
+
+    *ndead = 0;
+    stack[top++] = p;
+    while (top > 0) {
+        q = stack[--top];
+        dead[(*ndead)++] = q;
+        for (c = getPChild(q); c != NULL; c = getPSib(c))
+            stack[top++] = c;
+    }
+
+    for (top = 0; top < *ndead; ++top)
+        outBlocked(dead[top]);
+    outChild(p);
+    for (top = 0; top < *ndead; ++top)
+        freePcb(dead[top]);
+}
+
+
+/* Apply one operation, timing the calls to the kernel modules only.
+ * Processes woken by a V are left in *rq.  Return FALSE if the
+ * operation made `id' block. */
+static int apply(enum op op, int id, int arg, pcbq_t **rq,
+                 pcb_t **stack, pcb_t **dead, int *ndead) {
+    pcb_t *p = procOf[id];
+    pcb_t *c;
+    double t;
+    int ok = 1;
+    int i;
+
+    *ndead = 0;
+    if (p == NULL)
+        return 1;
+    /* Only an exit can happen to a blocked process. */
+    if (getPState(p) == PS_BLOCKED && op != OP_EXIT && op != OP_V)
+        return 0;
+
+    t = now();
+    switch (op) {
+    case OP_FORK:
+        c = allocPcb();
+        if (c != NULL)
+            insertChild(p, c);
+        record(op, now() - t);
+        if (c != NULL && arg >= 0 && arg < MAXPROC) {
+            procOf[arg] = c;
+            idOf[pcbIndex(c)] = arg;
+        }
+        else if (c != NULL) {
+            freePcb(c);
+        }
+        break;
+    case OP_EXIT:
+        killTree(p, stack, dead, ndead);
+        record(op, now() - t);
+        for (i = 0; i < *ndead; ++i) {
+            procOf[idOf[pcbIndex(dead[i])]] = NULL;
+            ++genOf[idOf[pcbIndex(dead[i])]];
+        }
+        break;
+    case OP_P:
+        ok = passerenN(sems[arg % nsems], p, 1) != 0;
+        record(op, now() - t);
+        break;
+    case OP_V:
+        verhogenN(sems[arg % nsems], 1, rq);
+        record(op, now() - t);
+        break;
+    default:
+        break;
+    }
+    /* Every operation stands for a kernel entry (untimed). */
+    checkSweep();
+
+    if (traceOut != NULL)
+        fprintf(traceOut, "%.0f %c %d %d\n", simTime, OPCHAR[op], id, arg);
+    return ok;
+}
+
+
+/****** Event queue of the synthetic workload.  ******/
+
+typedef struct event {
+    double e_time;
+    int    e_id;
+    int    e_gen;
+} event_t;
+
+static event_t *heap;
+static int heapLen;
+
+
+static void schedule(double time, int id) {
+    int i = heapLen++;
+
+    while (i > 0 && heap[(i - 1) / 2].e_time > time) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i].e_time = time;
+    heap[i].e_id = id;
+    heap[i].e_gen = genOf[id];
+}
+
+
+static event_t unschedule(void) {
+    event_t top = heap[0];
+    event_t last = heap[--heapLen];
+    int i = 0;
+    int c;
+
+    while ((c = 2 * i + 1) < heapLen) {
+        if (c + 1 < heapLen && heap[c + 1].e_time < heap[c].e_time)
+            ++c;
+        if (heap[c].e_time >= last.e_time)
+            break;
+        heap[i] = heap[c];
+        i = c;
+    }
+    heap[i] = last;
+    return top;
+}
+
+
+static unsigned int seed;
+
+static int rnd(int n) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+
+/* A population of about n processes, each of which, when it runs, does
+ * one operation and runs again a little later, unless it blocked. */
+static void synthetic(int n, long ops) {
+    pcb_t **stack = malloc(MAXPROC * sizeof(pcb_t *));
+    pcb_t **dead = malloc(MAXPROC * sizeof(pcb_t *));
+    pcbq_t *rq = mkEmptyProcQ();
+    event_t e;
+    long done;
+    int live = 1;
+    int nextId = 1;
+    int ndead;
+    int r;
+    int i;
+
+    heap = malloc((MAXPROC + 1) * sizeof(event_t));
+    heapLen = 0;
+    seed = 1;
+    reset(n / 4 + 1);
+    memset(genOf, 0, sizeof(genOf));
+    schedule(0, 0);
+
+    for (done = 0; done < ops; ++done) {
+        if (heapLen == 0) {
+            /* Everybody is blocked: release one waiter, on behalf of
+             * process 0 so that the trace shows it. */
+            for (i = 0; i < nsems && emptyProcQ(rq); ++i)
+                if (headBlocked(sems[i]) != NULL)
+                    apply(OP_V, 0, i, &rq, stack, dead, &ndead);
+            if (emptyProcQ(rq))
+                break;
+            schedule(0, idOf[pcbIndex(removeProcQ(&rq))]);
+        }
+
+        e = unschedule();
+        if (e.e_gen != genOf[e.e_id] || procOf[e.e_id] == NULL)
+            continue;
+        simTime = e.e_time;
+
+        r = rnd(100);
+        if (r < 15 && live < n) {
+            /* Find a free id; ids of dead processes are reused. */
+            while (procOf[nextId] != NULL)
+                nextId = (nextId + 1) % n;
+            apply(OP_FORK, e.e_id, nextId, &rq, stack, dead, &ndead);
+            if (procOf[nextId] != NULL) {
+                ++live;
+                schedule(e.e_time + 1 + rnd(10), nextId);
+            }
+        }
+        else if (r < 25 && e.e_id != 0 && live > n / 2) {
+            apply(OP_EXIT, e.e_id, 0, &rq, stack, dead, &ndead);
+            live -= ndead;
+            continue;
+        }
+        else if (r < 55) {
+            if (!apply(OP_P, e.e_id, rnd(nsems), &rq, stack, dead, &ndead))
+                continue;
+        }
+        else if (r < 85) {
+            apply(OP_V, e.e_id, rnd(nsems), &rq, stack, dead, &ndead);
+            while (!emptyProcQ(rq))
+                schedule(e.e_time + 1, idOf[pcbIndex(removeProcQ(&rq))]);
+        }
+        else {
+            apply(OP_SLEEP, e.e_id, 100 + rnd(1000), &rq, stack, dead, &ndead);
+            schedule(e.e_time + 100 + rnd(1000), e.e_id);
+            continue;
+        }
+        schedule(e.e_time + 1 + rnd(10), e.e_id);
+    }
+
+    free(heap);
+    free(stack);
+    free(dead);
+}
+
+
+/* Operations are applied in the order of the trace: its times only
+ * matter to the program that produced it. */
+static int replay(const char *path) {
+    pcb_t **stack = malloc(MAXPROC * sizeof(pcb_t *));
+    pcb_t **dead = malloc(MAXPROC * sizeof(pcb_t *));
+    pcbq_t *rq = mkEmptyProcQ();
+    FILE *f = fopen(path, "r");
+    double time;
+    char c;
+    int id, arg, ndead;
+    int op;
+    int res = 0;
+
+    if (f == NULL) {
+        perror(path);
+        free(stack);
+        free(dead);
+        return 1;
+    }
+
+    reset(MAXPROC);
+    while (fscanf(f, "%lf %c %d %d", &time, &c, &id, &arg) == 4) {
+        for (op = 0; op < OP_N && OPCHAR[op] != c; ++op)
+            ;
+        /* A semaphore number indexes sems: it cannot be negative. */
+        if (op == OP_N || id < 0 || id >= MAXPROC ||
+            ((op == OP_P || op == OP_V) && arg < 0)) {
+            fprintf(stderr, "%s: bad operation %c %d %d\n", path, c, id,
+                    arg);
+            res = 1;
+            break;
+        }
+        apply(op, id, arg, &rq, stack, dead, &ndead);
+        while (!emptyProcQ(rq))
+            removeProcQ(&rq);
+    }
+
+    fclose(f);
+    free(stack);
+    free(dead);
+    return res;
+}
+
+
+static void report(const char *title, double total) {
+    int i;
+
+    printf("%s: %.1f ms\n", title, total / 1e6);
+    for (i = 0; i < OP_N; ++i) {
+        double *s = samples[i];
+        long n = nsamples[i];
+
+        if (n == 0)
+            continue;
+        qsort(s, n, sizeof(double), cmpDouble);
+        printf("  %-5s %8ld ops  p50 %8.0f  p90 %8.0f  p99 %8.0f  "
+               "max %10.0f ns\n", OPNAME[i], n,
+               s[n / 2], s[n * 9 / 10], s[n * 99 / 100], s[n - 1]);
+    }
+}
+
+
+int main(int argc, char **argv) {
+    static const int SCALES[] = { 10, 100, 1000, 10000, 100000 };
+    char title[64];
+    double t;
+    unsigned int i;
+
+    if (argc == 3 && strcmp(argv[1], "-g") == 0) {
+        traceOut = stdout;
+        setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+        synthetic(atoi(argv[2]), 20L * atoi(argv[2]) + 1000);
+        return 0;
+    }
+    if (argc == 3 && strcmp(argv[1], "-r") == 0) {
+        t = now();
+        if (replay(argv[2]))
+            return 1;
+        report(argv[2], now() - t);
+        return 0;
+    }
+
+    for (i = 0; i < sizeof(SCALES) / sizeof(SCALES[0]); ++i) {
+        if (SCALES[i] > MAXPROC)
+            break;
+        t = now();
+        synthetic(SCALES[i], 20L * SCALES[i] + 1000);
+        sprintf(title, "%d processes", SCALES[i]);
+        report(title, now() - t);
+    }
+    return 0;
+}
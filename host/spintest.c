@@ -0,0 +1,91 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* spintest.c --- Check the spin of semTrySpin with a simulated clock.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include <stdio.h>
+
+#include "proc.h"
+#include "sema.h"
+
+/* Each reading of the clock takes one microsecond.  At releaseAt, if not
+ * 0, the holder of the semaphore releases it, as if it ran on another
+ * processor while the test spins. */
+static unsigned int simTime;
+static unsigned int releaseAt;
+static semd_t *sem;
+static pcbq_t *rq;
+
+
+unsigned int hostTOD(void) {
+    ++simTime;
+    if (releaseAt != 0 && simTime >= releaseAt) {
+        releaseAt = 0;
+        verhogenN(sem, 1, &rq);
+    }
+    return simTime;
+}
+
+
+static int failures;
+
+static void check(const char *name, int ok) {
+    printf("%s: %s\n", name, ok ? "OK" : "FAIL");
+    if (!ok)
+        ++failures;
+}
+
+
+int main(void) {
+    semspin_t st;
+    pcb_t *p;
+    unsigned int start;
+    int i;
+
+    initProc();
+    initASL();
+    rq = mkEmptyProcQ();
+    p = allocPcb();
+    initSemDPerm(&sem, 1);
+    setSemSpin(sem, 1);
+
+    /* Holds of 100 us bring the spin limit near 200 us. */
+    for (i = 0; i < 64; ++i) {
+        semTrySpin(sem);
+        simTime += 100;
+        verhogenN(sem, 1, &rq);
+    }
+    getSemSpin(sem, &st);
+    check("limit", st.ss_limit > 150 && st.ss_limit <= 200);
+
+    /* Released 50 us into the spin: taken without blocking. */
+    semTrySpin(sem);
+    releaseAt = simTime + 50;
+    check("spin", semTrySpin(sem) && getSValue(sem) == 0);
+    getSemSpin(sem, &st);
+    check("spin counted", st.ss_spun == 1 && st.ss_blocked == 0);
+
+    /* Never released: the spin gives up after the limit, then p blocks,
+     * and the next release wakes it. */
+    start = simTime;
+    check("give up", !semTrySpin(sem) && simTime - start >= st.ss_limit);
+    check("block", passerenSpin(sem, p) == 0 &&
+          getPState(p) == PS_BLOCKED);
+    getSemSpin(sem, &st);
+    check("block counted", st.ss_spun == 1 && st.ss_blocked == 1);
+    check("wakeup", verhogenN(sem, 1, &rq) == 1 && removeProcQ(&rq) == p);
+
+    /* Released between the two steps: the second takes it. */
+    check("give up again", !semTrySpin(sem));
+    verhogenN(sem, 1, &rq);
+    check("no lost wakeup", passerenSpin(sem, p) == 1 &&
+          getPState(p) != PS_BLOCKED && getSValue(sem) == 0);
+
+    return failures != 0;
+}
@@ -0,0 +1,278 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* swapbench.c --- Demand paging on a simulated disk, with and without
+   read-ahead.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "umps/arch.h"
+
+#include "proc.h"
+#include "sema.h"
+#include "diskq.h"
+#include "page.h"
+#include "as.h"
+#include "swap.h"
+
+/* Geometry and timings of the simulated disk, in microseconds, as in
+ * diskbench.c.  A sector holds a page. */
+#define CYLS        1024
+#define HEADS       4
+#define SECTS       16
+#define SEEK_BASE   1000
+#define SEEK_CYL    20
+#define XFER_SECT   300
+#define XFER_BASE   100
+
+/* The swap area, and the time an access takes when its page is mapped. */
+#define SWAP_CYL    512
+#define SLOTS       512
+#define ACCESS      10
+
+#define CLIENTS     4
+#define PAGES       (AS_NPTE - 1)
+#define FRAMES      24
+
+static pcb_t *procs[CLIENTS];
+static int step[CLIENTS];	/* Accesses done.  */
+static int retry[CLIENTS];	/* Page of the access to do again, or -1.  */
+static int retryWrite[CLIENTS];
+static unsigned int faultAt[CLIENTS];
+
+/* Value each page should hold, and the first word of each slot. */
+static unsigned int version[CLIENTS][PAGES];
+static unsigned int DISK[SLOTS];
+
+static unsigned int seed;
+static double diskTime;		/* Simulated time, in microseconds.  */
+
+
+unsigned int hostTOD(void) {
+    return (unsigned int) diskTime;
+}
+
+
+static int rnd(int n) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+
+/* Every page is written once, in order; then the pages are scanned in
+ * order, or picked at random, and one access in eight is a write.  An
+ * access that faulted is done again. */
+static int nextPage(int c, int sequential, int *write) {
+    int k = step[c];
+
+    if (retry[c] >= 0) {
+        *write = retryWrite[c];
+        return retry[c];
+    }
+    if (k < PAGES) {
+        *write = 1;
+        return k;
+    }
+    *write = rnd(8) == 0;
+    return sequential ? k % PAGES : rnd(PAGES);
+}
+
+
+/* Do the next access of client c: return FALSE if it faulted and is
+ * blocked.  A wrong value read is fatal. */
+static int touch(int c, int sequential) {
+    aspace_t *as = getPAs(procs[c]);
+    unsigned int v, pte;
+    unsigned int *w;
+    int page, write, res;
+
+    page = nextPage(c, sequential, &write);
+    v = AS_KUSEG_START + page * PAGESIZE;
+    for (;;) {
+        pte = asEntryLo(as, v);
+        if ((pte & AS_VALID) && (!write || (pte & AS_DIRTY)))
+            break;
+        res = swapFault(procs[c], v, write);
+        if (res < 0) {
+            fprintf(stderr, "bad access to %08x\n", v);
+            exit(1);
+        }
+        if (res == 0) {
+            faultAt[c] = hostTOD();
+            retry[c] = page;
+            retryWrite[c] = write;
+            return 0;
+        }
+    }
+    retry[c] = -1;
+
+    w = (unsigned int *) (unsigned long) (pte & AS_PFN_MASK);
+    if (write)
+        *w = ++version[c][page];
+    else if (*w != version[c][page]) {
+        fprintf(stderr, "page %d of client %d holds %u, not %u\n",
+                page, c, *w, version[c][page]);
+        exit(1);
+    }
+    ++step[c];
+    diskTime += ACCESS;
+    return 1;
+}
+
+
+/* The driver's part of the transfer r, which takes the time of the
+ * disk model. */
+static double transfer(ioreq_t *r, int *cyl) {
+    double t = XFER_BASE + XFER_SECT * r->r_count;
+    unsigned int *f;
+    int slot, write, i;
+
+    if (r->r_cyl != *cyl)
+        t += SEEK_BASE + SEEK_CYL * abs(r->r_cyl - *cyl);
+    *cyl = r->r_cyl;
+
+    slot = (r->r_cyl - SWAP_CYL) * HEADS * SECTS + r->r_head * SECTS +
+        r->r_sect;
+    for (i = 0; i < r->r_count; ++i) {
+        f = (unsigned int *) (unsigned long) swapSector(r, i, &write);
+        if (f == NULL)
+            continue;
+        if (write)
+            DISK[slot + i] = *f;
+        else
+            *f = DISK[slot + i];
+    }
+    return t;
+}
+
+
+/* The clients run in turn, one access each, while the disk serves the
+ * transfers; a client that faults runs again once swapDiskDone gives it
+ * back. */
+static void run(const char *name, int sequential, int readAhead, int per) {
+    pcbq_t *rq = mkEmptyProcQ();
+    pcbq_t *woken = mkEmptyProcQ();
+    swaparea_t area;
+    swapstats_t st;
+    diskstats_t ds;
+    diskq_t dq;
+    ioreq_t *r;
+    pcb_t *p;
+    double busyUntil = 0, blocked = 0;
+    unsigned int faults = 0, total = 0, acc = 0, p99 = 0;
+    int cyl = 0;
+    int c, i;
+
+    initProc();
+    initASL();
+    initIOReq();
+    initAS();
+    initDiskQ(&dq, IL_DISK, 0, DQ_CSCAN);
+    seed = 42;
+    diskTime = 0;
+
+    area.sa_dq = &dq;
+    area.sa_heads = HEADS;
+    area.sa_sects = SECTS;
+    area.sa_cyl = SWAP_CYL;
+    area.sa_slots = SLOTS;
+    initSwap(&area, allocPcb(), FRAMES);
+    swapSetReadAhead(readAhead);
+
+    for (c = 0; c < CLIENTS; ++c) {
+        procs[c] = allocPcb();
+        step[c] = 0;
+        retry[c] = -1;
+        for (i = 0; i < PAGES; ++i) {
+            version[c][i] = 0;
+            swapReserve(getPAs(procs[c]), AS_KUSEG_START + i * PAGESIZE, 1);
+        }
+        insertProcQ(&rq, procs[c]);
+    }
+
+    r = NULL;
+    for (;;) {
+        if (r == NULL && (r = diskStart(&dq)) != NULL)
+            busyUntil = diskTime + transfer(r, &cyl);
+        if (r == NULL && emptyProcQ(rq))
+            break;
+
+        if (r != NULL && (emptyProcQ(rq) || diskTime >= busyUntil)) {
+            if (diskTime < busyUntil)
+                diskTime = busyUntil;
+            swapDiskDone(&woken);
+            r = NULL;
+            while ((p = removeProcQ(&woken)) != NULL) {
+                c = pcbIndex(p) - pcbIndex(procs[0]);
+                blocked += hostTOD() - faultAt[c];
+                ++faults;
+                insertProcQ(&rq, p);
+            }
+            continue;
+        }
+
+        p = removeProcQ(&rq);
+        c = pcbIndex(p) - pcbIndex(procs[0]);
+        if (!touch(c, sequential))
+            continue;
+        if (step[c] < per)
+            insertProcQ(&rq, p);
+    }
+
+    swapStats(&st);
+    diskStats(&dq, &ds);
+    for (i = 0; i < HIST_BUCKETS; ++i)
+        total += st.sw_latency[i];
+    for (i = 0; i < HIST_BUCKETS && acc < total - total / 100; ++i)
+        acc += st.sw_latency[i];
+    if (i > 0)
+        p99 = 1u << i;
+
+    printf("%-10s ra %d  %8.1f ms  %5u major %5u minor %4u waits  "
+           "in %5u (%5u ahead)  out %5u in %4u batches  %5u transfers  "
+           "fault %7.1f us mean, p99 < %6u us\n",
+           name, readAhead, diskTime / 1000, st.sw_major, st.sw_minor,
+           st.sw_frameWaits, st.sw_pageIns, st.sw_readAhead,
+           st.sw_pageOuts, st.sw_batches, ds.ds_transfers,
+           faults ? blocked / faults : 0.0, p99);
+
+    for (c = 0; c < CLIENTS; ++c) {
+        swapRelease(getPAs(procs[c]));
+        asFree(getPAs(procs[c]));
+    }
+}
+
+
+int main(int argc, char **argv) {
+    int per = argc > 1 ? atoi(argv[1]) : 2000;
+    void *arena;
+    unsigned int base;
+
+    /* Frame addresses are 32 bits, as on the machine. */
+    arena = mmap(NULL, (FRAMES + 1) * PAGESIZE, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (arena == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    base = (unsigned int) (unsigned long) arena;
+
+    initPages(base, FRAMES);
+    run("sequential", 1, 1, per);
+    initPages(base, FRAMES);
+    run("sequential", 1, SWAP_READAHEAD, per);
+    initPages(base, FRAMES);
+    run("random", 0, 1, per);
+    initPages(base, FRAMES);
+    run("random", 0, SWAP_READAHEAD, per);
+    return 0;
+}
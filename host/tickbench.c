@@ -0,0 +1,90 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* tickbench.c --- Count the timer interrupts of the tickless timer on a
+   lightly loaded simulated machine.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "proc.h"
+#include "timer.h"
+
+#define SECONDS 60
+/* Each process runs for up to RUN us, then sleeps for up to SLEEP us.  */
+#define RUN     2000
+#define SLEEP   200000
+#define QUANTUM 5000
+
+static unsigned int seed;
+static unsigned int simTime;	/* Simulated time, in microseconds.  */
+
+
+unsigned int hostTOD(void) {
+    return simTime;
+}
+
+
+static unsigned int rnd(unsigned int n) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+
+/* One processor runs the ready processes in turn; the time jumps to the
+ * next event the timer is set for when none is ready. */
+static void run(int nprocs, unsigned int slack) {
+    pcbq_t *rq = mkEmptyProcQ();
+    timerstats_t st;
+    pcb_t *p;
+    int i;
+
+    initProc();
+    seed = 42;
+    simTime = 0;
+    initTimer(slack);
+    for (i = 0; i < nprocs; ++i)
+        timerAdd(allocPcb(), rnd(SLEEP));
+
+    while (simTime < SECONDS * 1000000) {
+        if (emptyProcQ(rq)) {
+            if (!timerNext(&simTime)) {
+                simTime = SECONDS * 1000000;
+                break;
+            }
+            timerInterrupt(&rq);
+            continue;
+        }
+        p = removeProcQ(&rq);
+        timerQuantum(simTime + QUANTUM);
+        simTime += rnd(RUN);
+        timerQuantumOff();
+        timerAdd(p, simTime + rnd(SLEEP));
+    }
+
+    timerStats(&st);
+    printf("%3d processes  slack %5u us  %6u interrupts (%5.1f/s)  "
+           "%5u coalesced  %6u avoided/s\n",
+           nprocs, slack, st.ts_interrupts,
+           st.ts_interrupts / (st.ts_elapsed / 1e6), st.ts_coalesced,
+           st.ts_avoidedPerSec);
+}
+
+
+int main(void) {
+    int nprocs[] = {0, 1, 4, 16};
+    unsigned int slacks[] = {0, 1000, 10000};
+    int i, j;
+
+    printf("A periodic timer takes %d interrupts/s.\n", 1000000 / TIMER_TICK);
+    for (i = 0; i < 4; ++i)
+        for (j = 0; j < 3; ++j)
+            run(nprocs[i], slacks[j]);
+    return 0;
+}
@@ -0,0 +1,128 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* lat.c --- Latency from device interrupts to the dispatch of waiters.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifdef LATENCY_PROFILE
+#include "umps/arch.h"
+
+#include "lat.h"
+#include "tod.h"
+
+/* Devices are numbered as the device semaphores: one class per external
+   interrupt line, then the terminal receivers. */
+#define LAT_CLASSES (N_EXT_IL + 1)
+#define LAT_DEVS    (LAT_CLASSES * N_DEV_PER_IL)
+
+/* Last interrupt of each device, if any. */
+static unsigned int DEV_IRQ[LAT_DEVS];
+static int DEV_STAMPED[LAT_DEVS];
+
+/* Whether each process was woken after an interrupt since its last
+ * dispatch, and then the interrupt, the wakeup and the class of its
+ * device. */
+static int PROC_WOKEN[MAXPROC];
+static unsigned int PROC_IRQ[MAXPROC];
+static unsigned int PROC_WAKE[MAXPROC];
+static int PROC_CLASS[MAXPROC];
+
+static latprof_t PROF[LAT_CLASSES];
+
+
+void initLat(void) {
+    int i, j;
+
+    addFreeHook(latForget);
+    for (i = 0; i < LAT_DEVS; ++i)
+        DEV_STAMPED[i] = 0;
+    for (i = 0; i < MAXPROC; ++i)
+        PROC_WOKEN[i] = 0;
+    for (i = 0; i < LAT_CLASSES; ++i) {
+        PROF[i].lp_wakeups = 0;
+        PROF[i].lp_maxTotal = 0;
+        for (j = 0; j < HIST_BUCKETS; ++j)
+            PROF[i].lp_handler[j] = PROF[i].lp_queue[j] =
+                PROF[i].lp_total[j] = 0;
+    }
+}
+
+
+/* Return the class of the sub-device sub of the line, as getDevSemD
+ * does, or -1. */
+static int latClass(int line, int sub) {
+    if (line < DEV_IL_START || line >= N_INTERRUPT_LINES)
+        return -1;
+    if (sub == 0)
+        return line - DEV_IL_START;
+    if (sub == 1 && line == IL_TERMINAL)
+        return N_EXT_IL;
+    return -1;
+}
+
+
+void latInterrupt(int line, int dev, int sub) {
+    int c = latClass(line, sub);
+
+    if (c < 0 || dev < 0 || dev >= N_DEV_PER_IL)
+        return;
+    DEV_IRQ[c * N_DEV_PER_IL + dev] = readTOD();
+    DEV_STAMPED[c * N_DEV_PER_IL + dev] = 1;
+}
+
+
+/* Only an interrupt that came while p was blocked woke it: a V by a
+ * process, or a stale stamp, is not counted. */
+void latWake(pcb_t *p, int i) {
+    unsigned int now = readTOD();
+    int k = pcbIndex(p);
+
+    if (i < 0 || i >= LAT_DEVS || !DEV_STAMPED[i] ||
+        (int) (DEV_IRQ[i] - getPStateTOD(p)) < 0)
+        return;
+
+    PROC_IRQ[k] = DEV_IRQ[i];
+    PROC_WAKE[k] = now;
+    PROC_CLASS[k] = i / N_DEV_PER_IL;
+    PROC_WOKEN[k] = 1;
+    ++PROF[PROC_CLASS[k]].lp_wakeups;
+    histAdd(PROF[PROC_CLASS[k]].lp_handler, now - DEV_IRQ[i]);
+}
+
+
+void latDispatch(pcb_t *p) {
+    unsigned int now = readTOD();
+    int k = pcbIndex(p);
+    latprof_t *lp;
+
+    if (!PROC_WOKEN[k])
+        return;
+
+    lp = &PROF[PROC_CLASS[k]];
+    histAdd(lp->lp_queue, now - PROC_WAKE[k]);
+    histAdd(lp->lp_total, now - PROC_IRQ[k]);
+    if (now - PROC_IRQ[k] > lp->lp_maxTotal)
+        lp->lp_maxTotal = now - PROC_IRQ[k];
+    PROC_WOKEN[k] = 0;
+}
+
+
+void latForget(pcb_t *p) {
+    PROC_WOKEN[pcbIndex(p)] = 0;
+}
+
+
+int getLatProf(int line, int sub, latprof_t *out) {
+    int c = latClass(line, sub);
+
+    if (c < 0 || out == NULL)
+        return 0;
+    *out = PROF[c];
+    return 1;
+}
+#endif
@@ -0,0 +1,58 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* lat.h --- Latency from device interrupts to the dispatch of waiters.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef LAT_H
+#define LAT_H
+
+/* Kept when compiled with -DLATENCY_PROFILE.  The interrupt handler
+   stamps each device interrupt with latInterrupt; a process that leaves
+   the semaphore of that device afterwards (see getDevSemD) is stamped
+   when it is woken, and again when it is next made PS_RUNNING.  The
+   delays between the three are counted in log-scale histograms, one set
+   per class of device.  Times are in TOD ticks.  */
+
+#ifdef LATENCY_PROFILE
+#include "proc.h"
+#include "hist.h"
+
+typedef struct latprof {
+    unsigned int lp_wakeups;	/* Waiters woken after an interrupt.  */
+    unsigned int lp_handler[HIST_BUCKETS];	/* Interrupt to wakeup.  */
+    unsigned int lp_queue[HIST_BUCKETS];	/* Wakeup to dispatch.  */
+    unsigned int lp_total[HIST_BUCKETS];	/* Interrupt to dispatch.  */
+    unsigned int lp_maxTotal;
+} latprof_t;
+
+/* Clear the stamps and the histograms.  Call it after initProc.  */
+void initLat (void);
+
+/* Stamp an interrupt of the device `dev' on the line `line'; `sub' is as
+   for getDevSemD.  Call it on entry to the interrupt handler.  */
+void latInterrupt (int line, int dev, int sub);
+
+/* Record that the process `p' was woken from the semaphore of the device
+   of index `i' in the order of getDevSemD: line by line, then the
+   terminal receivers.  Called by sema.c.  */
+void latWake (pcb_t *p, int i);
+
+/* Record that the process `p' is dispatched.  Called by setPState.  */
+void latDispatch (pcb_t *p);
+
+/* Forget the wakeup of `p', which is freed.  Called by freePcb (see
+   addFreeHook).  */
+void latForget (pcb_t *p);
+
+/* Copy the histograms of the devices on the line `line' (and sub-device
+   `sub') into `out'.  Return FALSE if there are no such devices.  */
+int getLatProf (int line, int sub, latprof_t *out);
+#endif
+
+#endif
@@ -0,0 +1,203 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* lock.c --- Mutexes and reader-writer locks.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include "lock.h"
+
+
+int initMutex(mutex_t *m) {
+    if (m == NULL)
+        return 0;
+
+    m->m_owner = NULL;
+    initSemDEmbed(&m->m_wait, 0);
+    return 1;
+}
+
+
+void freeMutex(mutex_t *m) {
+    if (m != NULL && m->m_owner == NULL)
+        freeSemD(&m->m_wait);
+}
+
+
+/* The fast path only looks at m_owner. */
+int mutexLock(mutex_t *m, pcb_t *p) {
+    if (m == NULL || p == NULL)
+        return 0;
+
+    if (m->m_owner == NULL) {
+        m->m_owner = p;
+        return 1;
+    }
+
+    insertBlocked(&m->m_wait, p);
+    return 0;
+}
+
+
+int mutexTryLock(mutex_t *m, pcb_t *p) {
+    if (m == NULL || p == NULL || m->m_owner != NULL)
+        return 0;
+
+    m->m_owner = p;
+    return 1;
+}
+
+
+/* Hand the mutex over to the first waiter, if any, so that it never
+ * looks free while someone waits for it. */
+pcb_t *mutexUnlock(mutex_t *m, pcbq_t **rq) {
+    if (m == NULL)
+        return NULL;
+
+    if (headBlocked(&m->m_wait) == NULL)
+        m->m_owner = NULL;
+    else
+        m->m_owner = moveBlocked(&m->m_wait, rq);
+
+    return m->m_owner;
+}
+
+
+
+
+int initRWLock(rwlock_t *rw, enum rw_policy policy) {
+    if (rw == NULL)
+        return 0;
+
+    rw->rw_readers = 0;
+    rw->rw_writer = NULL;
+    rw->rw_policy = policy;
+
+    initSemDEmbed(&rw->rw_readQ, 0);
+    initSemDEmbed(&rw->rw_writeQ, 0);
+    return 1;
+}
+
+
+void freeRWLock(rwlock_t *rw) {
+    if (rw == NULL || rw->rw_readers > 0 || rw->rw_writer != NULL)
+        return;
+
+    freeSemD(&rw->rw_readQ);
+    freeSemD(&rw->rw_writeQ);
+}
+
+
+/* A reader gets in as long as no writer holds the lock, unless writers
+ * are preferred and one is waiting. */
+int readLock(rwlock_t *rw, pcb_t *p) {
+    if (rw == NULL || p == NULL)
+        return 0;
+
+    if (rw->rw_writer == NULL &&
+        (rw->rw_policy == RW_READER_PREF ||
+         headBlocked(&rw->rw_writeQ) == NULL)) {
+        ++rw->rw_readers;
+        return 1;
+    }
+
+    insertBlocked(&rw->rw_readQ, p);
+    return 0;
+}
+
+
+int writeLock(rwlock_t *rw, pcb_t *p) {
+    if (rw == NULL || p == NULL)
+        return 0;
+
+    if (rw->rw_writer == NULL && rw->rw_readers == 0) {
+        rw->rw_writer = p;
+        return 1;
+    }
+
+    insertBlocked(&rw->rw_writeQ, p);
+    return 0;
+}
+
+
+/* Hand the lock over to the next writer. */
+static int wakeWriter(rwlock_t *rw, pcbq_t **rq) {
+    rw->rw_writer = moveBlocked(&rw->rw_writeQ, rq);
+    return rw->rw_writer != NULL;
+}
+
+
+/* Hand the lock over to every waiting reader at once. */
+static int wakeReaders(rwlock_t *rw, pcbq_t **rq) {
+    int n = moveBlockedN(&rw->rw_readQ, rq, MAXPROC);
+
+    rw->rw_readers += n;
+    return n;
+}
+
+
+int readUnlock(rwlock_t *rw, pcbq_t **rq) {
+    if (rw == NULL || rw->rw_readers == 0)
+        return 0;
+
+    if (--rw->rw_readers > 0)
+        return 0;
+
+    /* Readers only wait while a writer holds or waits for the lock, so
+     * the last reader out hands it over to a writer. */
+    return wakeWriter(rw, rq);
+}
+
+
+int writeUnlock(rwlock_t *rw, pcbq_t **rq) {
+    int n;
+
+    if (rw == NULL || rw->rw_writer == NULL)
+        return 0;
+
+    rw->rw_writer = NULL;
+
+    if (rw->rw_policy == RW_WRITER_PREF && wakeWriter(rw, rq))
+        return 1;
+
+    n = wakeReaders(rw, rq);
+    if (n == 0)
+        n = wakeWriter(rw, rq);
+    return n;
+}
+
+
+
+
+void initCond(condvar_t *cv) {
+    if (cv != NULL)
+        cv->cv_waitQ = mkEmptyProcQ();
+}
+
+
+void condWait(condvar_t *cv, mutex_t *m, pcb_t *p, pcbq_t **rq) {
+    if (cv == NULL || m == NULL || p == NULL || m->m_owner != p)
+        return;
+
+    insertProcQ(&cv->cv_waitQ, p);
+    mutexUnlock(m, rq);
+}
+
+
+pcb_t *condSignal(condvar_t *cv, pcbq_t **rq) {
+    if (cv == NULL)
+        return NULL;
+
+    return moveProcQ(&cv->cv_waitQ, rq);
+}
+
+
+/* The whole wait queue is spliced at once, whatever its length. */
+void condBroadcast(condvar_t *cv, pcbq_t **rq) {
+    if (cv != NULL)
+        spliceProcQ(&cv->cv_waitQ, rq);
+}
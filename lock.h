@@ -0,0 +1,117 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* lock.h --- Mutexes and reader-writer locks.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef LOCK_H
+#define LOCK_H
+
+#include "proc.h"
+#include "sema.h"
+
+/* Locks are meant to be embedded in the structures they protect, so their
+   type is public.  Only their wait queues are semaphores, embedded in
+   them: taking or releasing a lock nobody waits for never touches the
+   ASL, and there is no limit on the number of locks.
+
+   A process that cannot get a lock is blocked on it and the lock call
+   returns FALSE; the caller must then schedule another process.  When the
+   lock is released, it is handed over directly to the woken processes,
+   which are inserted in the ready queue given to the unlock call.  */
+
+typedef struct mutex {
+    pcb_t  *m_owner;		/* Process holding the mutex, or NULL.  */
+    semd_t  m_wait;		/* Processes waiting for the mutex.  */
+} mutex_t;
+
+enum rw_policy { RW_READER_PREF, RW_WRITER_PREF };
+
+typedef struct rwlock {
+    int     rw_readers;		/* Number of readers holding the lock.  */
+    pcb_t  *rw_writer;		/* Writer holding the lock, or NULL.  */
+    enum rw_policy rw_policy;
+    semd_t  rw_readQ;		/* Readers waiting for the lock.  */
+    semd_t  rw_writeQ;		/* Writers waiting for the lock.  */
+} rwlock_t;
+
+
+/* Condition variables only need a queue of processes: nothing else waits
+   on them, so they do not use a semaphore.  */
+typedef struct condvar {
+    pcbq_t *cv_waitQ;		/* Processes waiting for a signal.  */
+} condvar_t;
+
+
+/****** Mutexes.  ******/
+
+/* Initialize the mutex `m'.  Return FALSE if `m' is NULL.  */
+int initMutex (mutex_t *m);
+
+/* Release the resources of the unlocked mutex `m'.  */
+void freeMutex (mutex_t *m);
+
+/* Lock `m' for the process `p'.  Return TRUE if `p' holds `m'; otherwise
+   `p' is blocked until `m' is handed over to it.  */
+int mutexLock (mutex_t *m, pcb_t *p);
+
+/* Lock `m' for the process `p' if it is free.  Never blocks.  */
+int mutexTryLock (mutex_t *m, pcb_t *p);
+
+/* Unlock `m'.  If a process is waiting for `m', it becomes the owner and is
+   inserted at the tail of the process queue `rq'; it is returned.
+   Otherwise return NULL.  */
+pcb_t *mutexUnlock (mutex_t *m, pcbq_t **rq);
+
+
+/****** Reader-writer locks.  ******/
+
+/* Initialize the reader-writer lock `rw'.  With RW_READER_PREF, readers
+   may join readers holding the lock even if a writer waits; with
+   RW_WRITER_PREF, they wait behind any waiting writer, and writers are
+   woken first.  Return FALSE if `rw' is NULL.  */
+int initRWLock (rwlock_t *rw, enum rw_policy policy);
+
+/* Release the resources of the unlocked reader-writer lock `rw'.  */
+void freeRWLock (rwlock_t *rw);
+
+/* Lock `rw' for reading (resp. writing) by the process `p'.  Return TRUE
+   if `p' holds `rw'; otherwise `p' is blocked until it is handed
+   `rw'.  */
+int readLock (rwlock_t *rw, pcb_t *p);
+int writeLock (rwlock_t *rw, pcb_t *p);
+
+/* Release a read (resp. write) lock on `rw'.  The processes it is handed
+   over to are inserted at the tail of the process queue `rq'; all waiting
+   readers are released together.  Return the number of processes
+   woken.  */
+int readUnlock (rwlock_t *rw, pcbq_t **rq);
+int writeUnlock (rwlock_t *rw, pcbq_t **rq);
+
+
+
+/****** Condition variables.  ******/
+
+/* Initialize the condition variable `cv'.  */
+void initCond (condvar_t *cv);
+
+/* Make the process `p', which holds the mutex `m', wait on `cv' and
+   unlock `m' (see mutexUnlock for `rq').  Once signalled, `p' must lock
+   `m' again.  A process waiting on `cv' is not blocked on a semaphore, so
+   outBlocked does not see it.  */
+void condWait (condvar_t *cv, mutex_t *m, pcb_t *p, pcbq_t **rq);
+
+/* Wake the first process waiting on `cv' and insert it at the tail of
+   `rq'.  Return it, or NULL if nobody was waiting.  */
+pcb_t *condSignal (condvar_t *cv, pcbq_t **rq);
+
+/* Wake every process waiting on `cv' and append them to `rq', in
+   constant time.  */
+void condBroadcast (condvar_t *cv, pcbq_t **rq);
+
+#endif
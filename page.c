@@ -0,0 +1,360 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* page.c --- Allocation of page frames.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef NULL
+#define NULL ((void*)(0))
+#endif
+
+#include "page.h"
+#include "atomic.h"
+#include "check.h"
+
+/* A frame that heads a free block is FR_FREE, one that heads an
+   allocated block is FR_USED, and the other frames of a block are
+   FR_INSIDE.  A single frame kept by a processor is FR_CACHED: it is
+   free, but not in the buddy system.  */
+enum frame_state { FR_INSIDE, FR_FREE, FR_USED, FR_CACHED };
+
+typedef struct frame frame_t;
+
+/* Frame descriptor.  */
+struct frame {
+    frame_t *f_next;		/* Next free block of the same order.  */
+    frame_t *f_prev;		/* Previous free block of the same order.  */
+    int      f_order;		/* Order of the block it heads.  */
+    int      f_refs;		/* References to an allocated block.  */
+    enum frame_state f_state;
+};
+
+/* Frames cached by a processor.  */
+typedef struct pcache {
+    int      c_len;
+    frame_t *c_frames[PAGE_CACHE];
+} pcache_t;
+
+static frame_t FRAMES[MAXPAGES];
+static int pageCount;
+static unsigned int pageBase;
+
+/* For each order, a doubly linked list of the free blocks, so that a
+   buddy can be unlinked in constant time.  */
+static frame_t *FREE_LIST[PAGE_MAXORDER + 1];
+static int FREE_COUNT[PAGE_MAXORDER + 1];
+
+/* Taken by the processor that uses FREE_LIST.  */
+static int pageLockWord;
+
+static pcache_t CACHES[MAXCPU];
+
+
+
+static void pageLock (void) {
+    spinLock(&pageLockWord);
+}
+
+static void pageUnlock (void) {
+    spinUnlock(&pageLockWord);
+}
+
+
+static int frameIndex (frame_t *f) {
+    return f - FRAMES;
+}
+
+static unsigned int frameAddr (frame_t *f) {
+    return pageBase + frameIndex(f) * PAGESIZE;
+}
+
+/* Return the frame at addr, or NULL if it is not managed. */
+static frame_t *addrFrame (unsigned int addr) {
+    if (addr < pageBase || (addr - pageBase) % PAGESIZE != 0 ||
+        (addr - pageBase) / PAGESIZE >= (unsigned int) pageCount)
+        return NULL;
+    return &FRAMES[(addr - pageBase) / PAGESIZE];
+}
+
+
+static void freePush (frame_t *f, int order) {
+    f->f_state = FR_FREE;
+    f->f_order = order;
+    f->f_prev = NULL;
+    f->f_next = FREE_LIST[order];
+    if (FREE_LIST[order] != NULL)
+        FREE_LIST[order]->f_prev = f;
+    FREE_LIST[order] = f;
+    ++FREE_COUNT[order];
+}
+
+static void freeUnlink (frame_t *f) {
+    if (f->f_prev != NULL)
+        f->f_prev->f_next = f->f_next;
+    else
+        FREE_LIST[f->f_order] = f->f_next;
+    if (f->f_next != NULL)
+        f->f_next->f_prev = f->f_prev;
+    --FREE_COUNT[f->f_order];
+    f->f_state = FR_INSIDE;
+}
+
+
+/* Cut the frames into the largest blocks aligned on their size,
+ * counting from the first frame.  The partial pages at both ends of an
+ * unaligned region are not frames. */
+int initPages (unsigned int base, int npages) {
+    int i, k;
+
+    pageBase = (base + PAGESIZE - 1) / PAGESIZE * PAGESIZE;
+    if (pageBase != base)
+        --npages;
+    pageCount = npages < 0 ? 0 : npages > MAXPAGES ? MAXPAGES : npages;
+    pageLockWord = 0;
+
+    for (k = 0; k <= PAGE_MAXORDER; ++k) {
+        FREE_LIST[k] = NULL;
+        FREE_COUNT[k] = 0;
+    }
+    for (i = 0; i < MAXCPU; ++i)
+        CACHES[i].c_len = 0;
+    for (i = 0; i < pageCount; ++i)
+        FRAMES[i].f_state = FR_INSIDE;
+
+    for (i = 0; i < pageCount; i += 1 << k) {
+        k = 0;
+        while (k < PAGE_MAXORDER && i % (2 << k) == 0 &&
+               i + (2 << k) <= pageCount)
+            ++k;
+        freePush(&FRAMES[i], k);
+    }
+
+    return pageCount;
+}
+
+
+/* Take the smallest free block of at least 2^order frames and give
+ * back its upper halves until it is 2^order frames long.  The lock
+ * must be held. */
+static frame_t *buddyAlloc (int order) {
+    frame_t *f;
+    int k;
+
+    for (k = order; k <= PAGE_MAXORDER && FREE_LIST[k] == NULL; ++k)
+        ;
+    if (k > PAGE_MAXORDER)
+        return NULL;
+
+    f = FREE_LIST[k];
+    freeUnlink(f);
+    while (k > order) {
+        --k;
+        freePush(f + (1 << k), k);
+    }
+
+    f->f_state = FR_USED;
+    f->f_order = order;
+    f->f_refs = 1;
+    return f;
+}
+
+
+/* Merge the block f with its buddy for as long as the buddy is a free
+ * block of the same order.  The buddy of the block at index i of order
+ * k is at index i XOR 2^k.  The lock must be held. */
+static void buddyFree (frame_t *f) {
+    int i = frameIndex(f);
+    int k = f->f_order;
+    int b;
+
+    f->f_state = FR_INSIDE;
+    while (k < PAGE_MAXORDER) {
+        b = i ^ (1 << k);
+        if (b >= pageCount || FRAMES[b].f_state != FR_FREE ||
+            FRAMES[b].f_order != k)
+            break;
+        freeUnlink(&FRAMES[b]);
+        i &= ~(1 << k);
+        ++k;
+    }
+    freePush(&FRAMES[i], k);
+}
+
+
+unsigned int allocPages (int order) {
+    frame_t *f;
+
+    if (order < 0 || order > PAGE_MAXORDER)
+        return 0;
+
+    pageLock();
+    f = buddyAlloc(order);
+    pageUnlock();
+
+    /* Frames cached by this processor may complete a block. */
+    if (f == NULL && CACHES[cpuId()].c_len > 0) {
+        drainPages();
+        pageLock();
+        f = buddyAlloc(order);
+        pageUnlock();
+    }
+
+    return f == NULL ? 0 : frameAddr(f);
+}
+
+
+int freePages (unsigned int addr) {
+    frame_t *f = addrFrame(addr);
+
+    if (f == NULL)
+        return 0;
+
+    pageLock();
+    CHECK(f->f_state != FR_FREE && f->f_state != FR_CACHED,
+          "frame freed twice");
+    if (f->f_state != FR_USED) {
+        pageUnlock();
+        return 0;
+    }
+    buddyFree(f);
+    pageUnlock();
+    return 1;
+}
+
+
+/* An empty cache is refilled with half of its capacity at once, and a
+ * full one gives half of it back, so that the lock is taken at most
+ * once every PAGE_CACHE/2 calls.  Only this processor changes the state
+ * of the frames of its cache. */
+unsigned int allocPage (void) {
+    pcache_t *c = &CACHES[cpuId()];
+    frame_t *f;
+
+    if (c->c_len == 0) {
+        pageLock();
+        while (c->c_len < PAGE_CACHE / 2 && (f = buddyAlloc(0)) != NULL) {
+            f->f_state = FR_CACHED;
+            c->c_frames[c->c_len++] = f;
+        }
+        pageUnlock();
+        if (c->c_len == 0)
+            return 0;
+    }
+
+    f = c->c_frames[--c->c_len];
+    f->f_state = FR_USED;
+    f->f_refs = 1;
+    return frameAddr(f);
+}
+
+
+int freePage (unsigned int addr) {
+    pcache_t *c = &CACHES[cpuId()];
+    frame_t *f = addrFrame(addr);
+
+    if (f == NULL || f->f_state != FR_USED || f->f_order != 0) {
+        CHECK(f == NULL || (f->f_state != FR_FREE &&
+                            f->f_state != FR_CACHED), "frame freed twice");
+        return 0;
+    }
+
+    if (c->c_len == PAGE_CACHE) {
+        pageLock();
+        while (c->c_len > PAGE_CACHE / 2)
+            buddyFree(c->c_frames[--c->c_len]);
+        pageUnlock();
+    }
+
+    f->f_state = FR_CACHED;
+    f->f_refs = 0;
+    c->c_frames[c->c_len++] = f;
+    return 1;
+}
+
+
+/* Address spaces sharing a frame may run on different processors, so
+ * the counts change under the lock. */
+int pageRef (unsigned int addr) {
+    frame_t *f = addrFrame(addr);
+    int refs;
+
+    if (f == NULL || f->f_state != FR_USED)
+        return 0;
+    pageLock();
+    refs = ++f->f_refs;
+    pageUnlock();
+    return refs;
+}
+
+
+int pageUnref (unsigned int addr) {
+    frame_t *f = addrFrame(addr);
+    int refs;
+
+    if (f == NULL || f->f_state != FR_USED)
+        return 0;
+    pageLock();
+    refs = --f->f_refs;
+    pageUnlock();
+
+    if (refs == 0 && f->f_order == 0)
+        freePage(addr);
+    else if (refs == 0)
+        freePages(addr);
+    return refs;
+}
+
+
+int pageRefs (unsigned int addr) {
+    frame_t *f = addrFrame(addr);
+
+    return f == NULL || f->f_state != FR_USED ? 0 : f->f_refs;
+}
+
+
+void drainPages (void) {
+    pcache_t *c = &CACHES[cpuId()];
+
+    pageLock();
+    while (c->c_len > 0)
+        buddyFree(c->c_frames[--c->c_len]);
+    pageUnlock();
+}
+
+
+/* A request of order k can only use blocks of order k or more, so the
+ * free frames in smaller blocks are unusable for it. */
+void pageStats (pagestats_t *out) {
+    int small;
+    int i, k;
+
+    if (out == NULL)
+        return;
+
+    pageLock();
+    out->ps_total = pageCount;
+    out->ps_free = 0;
+    out->ps_largest = -1;
+    for (k = 0; k <= PAGE_MAXORDER; ++k) {
+        out->ps_blocks[k] = FREE_COUNT[k];
+        out->ps_free += FREE_COUNT[k] << k;
+        if (FREE_COUNT[k] > 0)
+            out->ps_largest = k;
+    }
+    pageUnlock();
+
+    out->ps_cached = 0;
+    for (i = 0; i < MAXCPU; ++i)
+        out->ps_cached += CACHES[i].c_len;
+
+    small = 0;
+    for (k = 0; k <= PAGE_MAXORDER; ++k) {
+        out->ps_frag[k] = out->ps_free == 0 ? 0 : small * 1000 / out->ps_free;
+        small += out->ps_blocks[k] << k;
+    }
+}
@@ -0,0 +1,94 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* page.h --- Allocation of page frames.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef PAGE_H
+#define PAGE_H
+
+/* Frames are handed out by a buddy system: blocks of 2^order contiguous
+   frames, for orders up to PAGE_MAXORDER, are split on allocation and
+   merged with their free buddy when freed, both in time proportional to
+   PAGE_MAXORDER.  Each processor also keeps a few single frames of its
+   own, so that allocPage and freePage rarely take the lock of the buddy
+   system.
+
+   The frames themselves are never touched: only their addresses are
+   handed out.  */
+
+#define PAGESIZE 4096
+
+/* Largest block order.  */
+#define PAGE_MAXORDER 10
+
+/* Maximum number of frames managed.  As for MAXPROC, the descriptors are
+   a static array.  */
+#ifndef MAXPAGES
+#define MAXPAGES 1024
+#endif
+
+/* Number of single frames each processor may keep.  */
+#define PAGE_CACHE 16
+
+typedef struct pagestats {
+    int ps_total;		/* Frames managed.  */
+    int ps_free;		/* Frames in free blocks.  */
+    int ps_cached;		/* Frames kept by the processors.  */
+    int ps_blocks[PAGE_MAXORDER + 1];	/* Free blocks of each order.  */
+    int ps_largest;		/* Order of the largest free block, or -1.  */
+    /* For each order, in thousandths, how much of the free memory is in
+       blocks too small for an allocation of that order.  */
+    int ps_frag[PAGE_MAXORDER + 1];
+} pagestats_t;
+
+/* Manage the frames in the `npages' pages of memory from the address
+   `base': one fewer if `base' is not a multiple of PAGESIZE, since the
+   frames start at the next one.  Frames allocated before are forgotten.
+   Return the number of frames managed, at most MAXPAGES.  */
+int initPages (unsigned int base, int npages);
+
+/* Allocate 2^order contiguous frames.  Return the address of the first,
+   or 0 if there is no free block large enough.  */
+unsigned int allocPages (int order);
+
+/* Free the block allocated by allocPages at `addr'.  Return FALSE if
+   `addr' is not such a block.  */
+int freePages (unsigned int addr);
+
+/* Allocate one frame, from the cache of the current processor if it can.
+   Return its address, or 0 if there is no free frame.  */
+unsigned int allocPage (void);
+
+/* Free the frame allocated by allocPage at `addr', into the cache of the
+   current processor if it has room.  Return FALSE if `addr' is not an
+   allocated frame.  */
+int freePage (unsigned int addr);
+
+/* Allocated blocks are reference counted, for sharing them between
+   address spaces: they start with one reference.  */
+
+/* Add a reference to the block at `addr'.  Return the number of
+   references, or 0 if `addr' is not an allocated block.  */
+int pageRef (unsigned int addr);
+
+/* Drop a reference to the block at `addr', and free it if it was the
+   last one.  Return the number of references left.  */
+int pageUnref (unsigned int addr);
+
+/* Return the number of references to the block at `addr', or 0.  */
+int pageRefs (unsigned int addr);
+
+/* Give the frames cached by the current processor back to the buddy
+   system.  */
+void drainPages (void);
+
+/* Fill `out' with the state of the allocator.  */
+void pageStats (pagestats_t *out);
+
+#endif
@@ -11,6 +11,12 @@
 
 #include "proc.h"
 #include "sema.h"
+#include "edf.h"
+#include "as.h"
+#include "tod.h"
+#include "check.h"
+#include "lat.h"
+#include "atomic.h"
 
 /* Process Control Block.  */
 struct pcb {
@@ -24,6 +30,23 @@ struct pcb {
 
     /* Semaphore fields.  */
     semd_t  *p_sema;  /* Pointer to semaphore on which process is blocked.  */
+    int      p_units;     /* Number of units requested on p_sema.  */
+
+    /* Scheduling fields.  */
+    edfnode_t p_edf;            /* Deadline and EDF heap position.  */
+
+    /* Memory fields.  */
+    aspace_t p_as;              /* ASID and page table.  */
+
+    /* State fields.  */
+    enum proc_state p_state;
+    pcb_t   *p_sprev;           /* Previous process in the same state.  */
+    pcb_t   *p_snext;           /* Next process in the same state.  */
+
+    /* Accounting fields.  */
+    unsigned int p_stateTOD;    /* TOD when p_state was last changed.  */
+    pacct_t  p_acct;            /* What this process used.  */
+    pacct_t  p_cacct;           /* What its removed descendants used.  */
 
     /* ...other fields will come later... */
 };
@@ -34,54 +57,241 @@ struct pcb {
 /* Array of MAXPROC pcb's. */
 static pcb_t PROCESS_POOL[MAXPROC];
 
-/* Pointer to the head of free (unused) pcb linked list. */
-static pcb_t *pcb_free_h;
+/* For each state, a doubly linked list of the processes in that state,
+ * through p_sprev and p_snext, and its length.  The PS_FREE list is the
+ * list of pcb's that have been freed. */
+static pcb_t *STATE_LIST[PS_NSTATES];
+static int STATE_COUNT[PS_NSTATES];
+
+/* Index of the first pcb of PROCESS_POOL that has never been handed
+ * out.  PROCESS_POOL[pcb_bump..MAXPROC-1] are free as well. */
+static int pcb_bump;
 
+/* Functions freePcb calls, see addFreeHook. */
+static pcbhook_t FREE_HOOKS[PROC_MAXHOOKS];
+static int nHooks;
 
 
 
 
-/* Create the linked list of unused pcb's.' */
+
+/* Nothing is threaded at initialization: pcb's that were never used are
+ * handed out through pcb_bump, so this takes constant time whatever the
+ * value of MAXPROC. */
 void initProc (void) {
     int i;
 
-    for (i = 0; i < MAXPROC-1; ++i)
-        PROCESS_POOL[i].p_next = &PROCESS_POOL[i+1];
-    PROCESS_POOL[MAXPROC-1].p_next = NULL;
-    pcb_free_h = &PROCESS_POOL[0];
+    for (i = 0; i < PS_NSTATES; ++i) {
+        STATE_LIST[i] = NULL;
+        STATE_COUNT[i] = 0;
+    }
+    pcb_bump = 0;
+    nHooks = 0;
+}
+
+
+int addFreeHook (pcbhook_t h) {
+    int i;
+
+    for (i = 0; i < nHooks; ++i)
+        if (FREE_HOOKS[i] == h)
+            return 1;
+    if (h == NULL || nHooks == PROC_MAXHOOKS)
+        return 0;
+    FREE_HOOKS[nHooks++] = h;
+    return 1;
+}
+
+
+/* Push p on the list of the state st. */
+static void stateLink(pcb_t *p, enum proc_state st) {
+    CHECK(STATE_LIST[st] == NULL || STATE_LIST[st]->p_sprev == NULL,
+          "state list head has a predecessor");
+    p->p_state = st;
+    p->p_sprev = NULL;
+    p->p_snext = STATE_LIST[st];
+    if (STATE_LIST[st] != NULL)
+        STATE_LIST[st]->p_sprev = p;
+    STATE_LIST[st] = p;
+    ++STATE_COUNT[st];
+}
+
+
+/* Take p off the list of its state. */
+static void stateUnlink(pcb_t *p) {
+    CHECK(p->p_sprev == NULL ? STATE_LIST[p->p_state] == p
+                             : p->p_sprev->p_snext == p,
+          "process missing from its state list");
+    if (p->p_sprev != NULL)
+        p->p_sprev->p_snext = p->p_snext;
+    else
+        STATE_LIST[p->p_state] = p->p_snext;
+    if (p->p_snext != NULL)
+        p->p_snext->p_sprev = p->p_sprev;
+    --STATE_COUNT[p->p_state];
 }
 
-/* Return a pcb to the unused pcb list */
+
+/* Return a pcb to the unused pcb list.  Freeing it twice is ignored.
+ * The hooks run last added first, so a module let go of p before the
+ * modules it is built on. */
 void freePcb(pcb_t *p) {
+    int i;
+
     if (p == NULL)
         return;
-    p->p_next = pcb_free_h;
-    pcb_free_h = p;
+    CHECK(p->p_state != PS_FREE, "pcb freed twice");
+    if (p->p_state == PS_FREE)
+        return;
+    CHECK(p->p_next == NULL, "freeing a process that is on a queue");
+    CHECK(p->p_sema == NULL, "freeing a blocked process");
+    for (i = nHooks - 1; i >= 0; --i)
+        FREE_HOOKS[i](p);
+    stateUnlink(p);
+    stateLink(p, PS_FREE);
 }
 
 
 /* Allocate a new process.  Return NULL if there is no PCB left.  */
 pcb_t *allocPcb(void) {
     pcb_t *p;
+    int i;
 
-    if (pcb_free_h == NULL)
+    /* Reuse a freed pcb first, and only then touch a new slot. */
+    if (STATE_LIST[PS_FREE] != NULL) {
+        p = STATE_LIST[PS_FREE];
+        stateUnlink(p);
+    }
+    else if (pcb_bump < MAXPROC) {
+        p = &PROCESS_POOL[pcb_bump++];
+    }
+    else {
         return NULL;
-
-    /* Obtain the pcb at the head of the unused pcb list and return it.
-     * Change the head of unused pcb list to be the next free pcb. */
-    p = pcb_free_h;
-    pcb_free_h = pcb_free_h->p_next;
+    }
 
     p->p_next   = NULL;
     p->p_parent = NULL;
     p->p_child  = NULL;
     p->p_sib    = NULL;
     p->p_sema   = NULL;
+    p->p_units  = 0;
+    p->p_stateTOD = readTOD();
+    p->p_acct.pa_cpu = p->p_acct.pa_wait = p->p_acct.pa_blocked = 0;
+    p->p_acct.pa_switches = 0;
+    p->p_cacct = p->p_acct;
+    p->p_edf.e_deadline = 0;
+    p->p_edf.e_util = 0;
+    p->p_edf.e_idx = -1;
+    p->p_as.as_asid = 0;
+    p->p_as.as_cpus = 0;
+    for (i = 0; i < AS_NPTE; ++i)
+        p->p_as.as_pte[i] = 0;
+    stateLink(p, PS_READY);
 
     return p;
 }
 
 
+enum proc_state getPState(pcb_t *p) {
+    return p->p_state;
+}
+
+
+unsigned int getPStateTOD(pcb_t *p) {
+    return p->p_stateTOD;
+}
+
+
+/* Add the time p has spent in its current state to the counter of that
+ * state. */
+static void acctCharge(pcb_t *p) {
+    unsigned int now = readTOD();
+    unsigned int spent = now - p->p_stateTOD;
+
+    p->p_stateTOD = now;
+    if (p->p_state == PS_RUNNING)
+        p->p_acct.pa_cpu += spent;
+    else if (p->p_state == PS_READY)
+        p->p_acct.pa_wait += spent;
+    else if (p->p_state == PS_BLOCKED)
+        p->p_acct.pa_blocked += spent;
+}
+
+
+void setPState(pcb_t *p, enum proc_state st) {
+    if (p == NULL || st == PS_FREE || st >= PS_NSTATES ||
+        p->p_state == PS_FREE || p->p_state == st)
+        return;
+    acctCharge(p);
+    if (st == PS_RUNNING) {
+        ++p->p_acct.pa_switches;
+#ifdef LATENCY_PROFILE
+        latDispatch(p);
+#endif
+    }
+    stateUnlink(p);
+    stateLink(p, st);
+}
+
+
+void getPAcct(pcb_t *p, pacct_t *self, pacct_t *children) {
+    if (p == NULL)
+        return;
+    if (self != NULL)
+        *self = p->p_acct;
+    if (children != NULL)
+        *children = p->p_cacct;
+}
+
+
+/* Add what the removed descendant c and its own removed descendants
+ * used to the total of p. */
+static void acctReap(pcb_t *p, pcb_t *c) {
+    acctCharge(c);
+    p->p_cacct.pa_cpu += c->p_acct.pa_cpu + c->p_cacct.pa_cpu;
+    p->p_cacct.pa_wait += c->p_acct.pa_wait + c->p_cacct.pa_wait;
+    p->p_cacct.pa_blocked += c->p_acct.pa_blocked + c->p_cacct.pa_blocked;
+    p->p_cacct.pa_switches += c->p_acct.pa_switches + c->p_cacct.pa_switches;
+}
+
+
+/* Never used pcb's are free too, but are on no list. */
+int countProcState(enum proc_state st) {
+    if (st >= PS_NSTATES)
+        return 0;
+    if (st == PS_FREE)
+        return STATE_COUNT[PS_FREE] + MAXPROC - pcb_bump;
+    return STATE_COUNT[st];
+}
+
+
+int listProcState(enum proc_state st, pcb_t **out, int max) {
+    pcb_t *p;
+    int n = 0;
+    int i;
+
+    if (st >= PS_NSTATES || out == NULL)
+        return 0;
+
+    for (p = STATE_LIST[st]; p != NULL && n < max; p = p->p_snext)
+        out[n++] = p;
+
+    if (st == PS_FREE)
+        for (i = pcb_bump; i < MAXPROC && n < max; ++i)
+            out[n++] = &PROCESS_POOL[i];
+
+    return n;
+}
+
+
+
+
+
+int pcbIndex(pcb_t *p) {
+    return p - PROCESS_POOL;
+}
+
+
 
 
 
@@ -97,30 +307,46 @@ int emptyProcQ(pcbq_t *pq) {
 }
 
 
-/* To insert a process in a queue: if the queue is empty, the queue is
- * the process pointing to itself, otherwise the process will insert
- * itself between the tail and its previous neighbor. */
+/* A queue is represented by its tail, whose p_next points to the head.
+ * To insert a process, link it between the tail and the head and make
+ * it the new tail.  A process on no queue has a null p_next. */
 void insertProcQ(pcbq_t **pqp, pcb_t *p) {
-    if (pqp == NULL || p == NULL) {
+    if (pqp == NULL || p == NULL)
         return;
-    }
-    else if (emptyProcQ(*pqp)) {
+
+    CHECK(p->p_state != PS_FREE, "queueing a free process");
+    CHECK(p->p_next == NULL, "process is already on a queue");
+    CHECK(*pqp == NULL || (*pqp)->p_next != NULL, "queue is not circular");
+
+    if (emptyProcQ(*pqp)) {
         p->p_next = p;
         *pqp = p;
     }
     else {
         p->p_next = (*pqp)->p_next;
         (*pqp)->p_next = p;
+        *pqp = p;
     }
 }
 
 
-/* To remove the head from a queue, call outProcQ. */
+/* The head is right after the tail, so removing it never needs to walk
+ * the queue. */
 pcb_t *removeProcQ(pcbq_t **pqp) {
-    if (pqp == NULL)
+    pcb_t *head;
+
+    if (pqp == NULL || emptyProcQ(*pqp))
         return NULL;
 
-    return outProcQ(pqp, *pqp);
+    head = (*pqp)->p_next;
+    CHECK(head != NULL, "queue is not circular");
+    if (head == *pqp)
+        *pqp = mkEmptyProcQ();
+    else
+        (*pqp)->p_next = head->p_next;
+
+    head->p_next = NULL;
+    return head;
 }
 
 
@@ -129,39 +355,35 @@ pcb_t *removeProcQ(pcbq_t **pqp) {
  * exist. */
 pcb_t *outProcQ(pcbq_t **pqp, pcb_t *p) {
     pcb_t *prev;
-    pcb_t *curr;
 
     if (pqp == NULL || emptyProcQ(*pqp) || p == NULL)
         return NULL;
 
+    /* Find the element before p, starting from the tail so that the
+     * head is checked first. */
     prev = *pqp;
-    curr = *pqp;
-
-    /* Try to find p in pqp. */
-    while (curr != p) {
-        curr = curr->p_next;
+    while (prev->p_next != p) {
+        prev = prev->p_next;
+        CHECK(prev != NULL, "queue is not circular");
 
-        /* If curr == *pqp, then we have looped and p is not in
+        /* If prev == *pqp, then we have looped and p is not in
          * pqp. */
-        if (curr == *pqp)
+        if (prev == *pqp)
             return NULL;
     }
 
-
-    /* Get the element before p. */
-    while (prev->p_next != p)
-        prev = prev->p_next;
-
     /* Update the queue. */
-    if (curr == prev) {
+    if (prev == p) {
         /* Queue has a single element. */
         *pqp = mkEmptyProcQ();
     }
     else {
         prev->p_next = p->p_next;
-        *pqp = prev;
+        if (*pqp == p)
+            *pqp = prev;
     }
 
+    p->p_next = NULL;
     return p;
 }
 
@@ -171,33 +393,176 @@ pcb_t *headProcQ(pcbq_t *pq) {
     if (pq == NULL)
         return NULL;
     else
-        return pq;
+        return pq->p_next;
+}
+
+
+/* Detach the head and link it after the tail of `to' directly, rather
+ * than going through removeProcQ and insertProcQ. */
+pcb_t *moveProcQ(pcbq_t **from, pcbq_t **to) {
+    if (to == NULL)
+        return NULL;
+
+    return moveProcQN(from, to, 1) == 1 ? (*to) : NULL;
+}
+
+
+/* Find the last of the `k' first elements of `from', cut the segment
+ * out and splice it at the end of `to'.  Only the `k' moved elements
+ * are visited. */
+int moveProcQN(pcbq_t **from, pcbq_t **to, int k) {
+    pcb_t *head;
+    pcb_t *last;
+    int n;
+
+    if (from == NULL || to == NULL || emptyProcQ(*from) || k <= 0)
+        return 0;
+
+    head = (*from)->p_next;
+    last = head;
+    for (n = 1; n < k && last != *from; ++n)
+        last = last->p_next;
+
+    /* Cut [head, last] out of `from'. */
+    if (last == *from)
+        *from = mkEmptyProcQ();
+    else
+        (*from)->p_next = last->p_next;
+
+    /* Splice [head, last] after the tail of `to'. */
+    if (emptyProcQ(*to)) {
+        last->p_next = head;
+    }
+    else {
+        last->p_next = (*to)->p_next;
+        (*to)->p_next = head;
+    }
+    *to = last;
+
+    return n;
 }
 
 
+/* Exchanging the successors of the two tails links the tail of `to' to
+ * the head of `from' and the tail of `from' to the head of `to'. */
+void spliceProcQ(pcbq_t **from, pcbq_t **to) {
+    pcb_t *head;
+
+    if (from == NULL || to == NULL || emptyProcQ(*from) || from == to)
+        return;
+
+    if (!emptyProcQ(*to)) {
+        head = (*to)->p_next;
+        (*to)->p_next = (*from)->p_next;
+        (*from)->p_next = head;
+    }
+    *to = *from;
+    *from = mkEmptyProcQ();
+}
+
+
+/* Walk `from' once from head to tail.  A process whose request fits
+ * in what is left of *avail is unlinked and appended to `to'. */
+int moveProcQUnits(pcbq_t **from, pcbq_t **to, int *avail, int fair) {
+    pcb_t *prev;
+    pcb_t *curr;
+    int last;
+    int n = 0;
+
+    if (from == NULL || to == NULL || avail == NULL || emptyProcQ(*from))
+        return 0;
+
+    prev = *from;
+    do {
+        curr = prev->p_next;
+        last = curr == *from;
+
+        if (curr->p_units <= *avail) {
+            *avail -= curr->p_units;
+
+            /* Unlink curr; prev stays where it is. */
+            if (prev == curr) {
+                *from = mkEmptyProcQ();
+            }
+            else {
+                prev->p_next = curr->p_next;
+                if (*from == curr)
+                    *from = prev;
+            }
+            curr->p_next = NULL;
+            insertProcQ(to, curr);
+            ++n;
+        }
+        else if (fair) {
+            break;
+        }
+        else {
+            prev = curr;
+        }
+    } while (!last && !emptyProcQ(*from));
+
+    return n;
+}
+
+
+/* The tail has no next element. */
+pcb_t *nextProcQ(pcbq_t *pq, pcb_t *p) {
+    if (pq == NULL || p == NULL || p == pq)
+        return NULL;
+    return p->p_next;
+}
+
+
+int     getPUnits(pcb_t *p) { return p->p_units; }
+void    setPUnits(pcb_t *p, int n) { p->p_units = n; }
+semd_t *getPSema(pcb_t *p) { return p->p_sema; }
+void    setPSema(pcb_t *p, semd_t *s) { p->p_sema = s; }
+edfnode_t *getPEdf(pcb_t *p) { return &p->p_edf; }
+aspace_t *getPAs(pcb_t *p) { return &p->p_as; }
+
+
 /* Return TRUE iff the process `p' has no children.  */
 int emptyChild(pcb_t *p) {
     return p != NULL && p->p_child == NULL;
 }
 
 
-/* Insert a new child at the head of the list of children of parent. */
+pcb_t *headChild(pcb_t *p) {
+    return p == NULL ? NULL : (pcb_t *) loadPtr(&p->p_child);
+}
+
+
+pcb_t *nextChild(pcb_t *p) {
+    return p == NULL ? NULL : (pcb_t *) loadPtr(&p->p_sib);
+}
+
+
+/* Insert a new child at the head of the list of children of parent.
+ * The child is linked to its siblings before it is published, so a
+ * reader that sees it also sees the rest of the list. */
 void insertChild(pcb_t *parent, pcb_t *child) {
     if (parent == NULL || child == NULL || child->p_parent != NULL)
         return;
 
-    /* Child is added at the beginning of the siblings list. */
-    if (parent->p_child != NULL) {
-        child->p_sib = parent->p_child;
-    }
+    CHECK(parent != child, "process made its own child");
+    CHECK(parent->p_state != PS_FREE && child->p_state != PS_FREE,
+          "free process in the process tree");
+    CHECK(parent->p_child == NULL || parent->p_child->p_parent == parent,
+          "first child has a wrong parent");
 
+    /* Child is added at the beginning of the siblings list. */
+    child->p_sib = parent->p_child;
     child->p_parent = parent;
+    memBarrier();
     parent->p_child = child;
 }
 
 
 /* Remove the first child of p.  If this child has children, remove
- * them all (apply this operation recursively).*/
+ * them all (apply this operation recursively).  The child is accounted
+ * to p once its own children are accounted to it.  Removed processes
+ * keep their p_sib, so that readers still on them go on to the rest of
+ * the list. */
 pcb_t *removeChild(pcb_t *p) {
     pcb_t *child;
 
@@ -206,13 +571,14 @@ pcb_t *removeChild(pcb_t *p) {
 
 
     child = p->p_child;
+    CHECK(child->p_parent == p, "child has a wrong parent");
     p->p_child = child->p_sib;
     child->p_parent = NULL;
-    child->p_sib = NULL;
 
     /* If child has children of his own, remove them. */
     while (!emptyChild(child))
         removeChild(child);
+    acctReap(p, child);
 
     return child;
 }
@@ -233,6 +599,7 @@ pcb_t *outChild(pcb_t *p) {
 
     /* Child is the first sibling. */
     if (p->p_parent->p_child == p) {
+        acctReap(p->p_parent, p);
         p->p_parent->p_child = p->p_sib;
         p->p_parent = NULL;
         return p;
@@ -244,9 +611,11 @@ pcb_t *outChild(pcb_t *p) {
             prev = prev->p_sib;
 
         if (prev->p_sib == NULL) {
+            CHECK(0, "process missing from its parent's children");
             return NULL;
         }
 
+        acctReap(p->p_parent, p);
         p->p_parent = NULL;
         prev->p_sib = p->p_sib;
         return p;
@@ -254,6 +623,50 @@ pcb_t *outChild(pcb_t *p) {
 }
 
 
+#ifdef VALIDATE
+/* Position of the next pcb to check in PROCESS_POOL. */
+static int checkNext;
+
+/* Check the links from p to its neighbours.  Each of them is checked
+ * in turn as well, so only one side of every link is looked at. */
+static void checkPcb(pcb_t *p) {
+    if (p->p_state == PS_FREE) {
+        CHECK(p->p_next == NULL && p->p_sema == NULL,
+              "free process is in use");
+        return;
+    }
+
+    CHECK(p->p_next == NULL ||
+          (p->p_next->p_state != PS_FREE && p->p_next->p_next != NULL),
+          "queue is not circular");
+    CHECK(p->p_parent == NULL ||
+          (p->p_parent->p_state != PS_FREE && p->p_parent->p_child != NULL),
+          "parent has no children");
+    CHECK(p->p_child == NULL || p->p_child->p_parent == p,
+          "child has a wrong parent");
+    CHECK(p->p_parent == NULL || p->p_sib == NULL ||
+          p->p_sib->p_parent == p->p_parent,
+          "siblings have different parents");
+    CHECK((p->p_state == PS_BLOCKED) == (p->p_sema != NULL),
+          "blocked state and semaphore disagree");
+    CHECK(p->p_snext == NULL ||
+          (p->p_snext->p_sprev == p && p->p_snext->p_state == p->p_state),
+          "broken state list");
+}
+
+
+int procCheckStep(int n) {
+    int i;
+
+    for (i = 0; i < n && i < pcb_bump; ++i) {
+        if (checkNext >= pcb_bump)
+            checkNext = 0;
+        checkPcb(&PROCESS_POOL[checkNext++]);
+    }
+
+    return i;
+}
+#endif
 
 
 /* Functions for debugging and testing. */
@@ -269,15 +682,6 @@ pcb_t  *getPNext(pcb_t *p) { return p->p_next; }
 pcb_t  *getPParent(pcb_t *p) { return p->p_parent; }
 pcb_t  *getPChild(pcb_t *p) { return p->p_child; }
 pcb_t  *getPSib(pcb_t *p) { return p->p_sib; }
-semd_t *getPSema(pcb_t *p) { return p->p_sema; }
-int getFreeProcessCount(void) {
-    int count = 0;
-    pcb_t *curr = pcb_free_h;
-    while (curr != NULL) {
-        count++;
-        curr = curr->p_next;
-    }
-    return count;
-}
+int getFreeProcessCount(void) { return countProcState(PS_FREE); }
 
 #endif
@@ -12,30 +12,103 @@ the Free Software Foundation, either version 3 of the License, or
 #ifndef PROC_H
 #define PROC_H
 
+#ifndef NULL
 #define NULL ((void*)(0))
+#endif
 
 /* Since we don't have the C library at hand, we don't have malloc and
    friends, so we will have to make do with a hardcoded limit on the maximum
-   number of processes.  */
+   number of processes.  It may be overridden at compile time; initProc
+   does not depend on it.  */
+#ifndef MAXPROC
 #define MAXPROC 20
+#endif
 
 
 /* The type of process objects.  */
 typedef struct pcb pcb_t;
-/* Process queues are represented by one of their members.  */
+/* Process queues are represented by their tail, whose successor is the
+   head.  */
 typedef pcb_t pcbq_t;
 
 typedef struct semd semd_t;
 
+typedef struct edfnode edfnode_t;	/* See edf.h.  */
+typedef struct aspace aspace_t;		/* See as.h.  */
+
+/* The states a process can be in.  A PS_BLOCKED process is blocked on the
+   semaphore given by getPSema.  */
+enum proc_state { PS_FREE, PS_READY, PS_RUNNING, PS_BLOCKED, PS_NSTATES };
+
 /****** General creation destruction of process objects.  ******/
 
-/* Initialize the process handling module.  */
+/* Initialize the process handling module, with no free hook.  */
 void initProc (void);
 /* Allocate a new process.  Return NULL if there is no PCB left.  */
 pcb_t *allocPcb (void);
-/* Free a process.  */
+/* Free a process, once the free hooks have let go of it.  */
 void freePcb (pcb_t *p);
 
+/* A function freePcb calls on the process it frees, so that a module
+   that keeps per-process state lets go of it: edf.c, timer.c, lat.c,
+   as.c and swap.c add theirs when they are initialized, after
+   initProc.  */
+typedef void (*pcbhook_t) (pcb_t *p);
+#ifndef PROC_MAXHOOKS
+#define PROC_MAXHOOKS 8
+#endif
+
+/* Have freePcb call `h', before the hooks added earlier.  Adding a hook
+   again does nothing.  Return FALSE if PROC_MAXHOOKS hooks are added
+   already.  */
+int addFreeHook (pcbhook_t h);
+/* Return the position of `p' in the pool of processes, from 0 to
+   MAXPROC-1, so that other modules can keep per-process tables.  */
+int pcbIndex (pcb_t *p);
+
+
+/****** Process states.  ******/
+
+/* Every process is on a list of the processes in the same state.
+   allocPcb makes a process PS_READY and freePcb makes it PS_FREE;
+   insertBlocked and the functions that remove a process from a semaphore
+   move it to and from PS_BLOCKED.  */
+
+/* Return the state of the process `p'.  */
+enum proc_state getPState (pcb_t *p);
+
+/* Move the allocated process `p' to the state `st', which cannot be
+   PS_FREE.  Constant time.  The time since `p' entered its previous state
+   is charged to it (see getPAcct), so the scheduler must call it when it
+   dispatches and preempts processes.  */
+void setPState (pcb_t *p, enum proc_state st);
+
+/* Return the TOD at which `p' entered its current state.  */
+unsigned int getPStateTOD (pcb_t *p);
+
+/* Return the number of processes in the state `st'.  Constant time.  */
+int countProcState (enum proc_state st);
+
+/* Store at most `max' processes in the state `st' in `out' and return
+   their number.  Takes time proportional to that number.  */
+int listProcState (enum proc_state st, pcb_t **out, int max);
+
+/****** Accounting.  ******/
+
+/* What a process used, in TOD ticks.  */
+typedef struct pacct {
+    unsigned int pa_cpu;	/* Time spent PS_RUNNING.  */
+    unsigned int pa_wait;	/* Time spent PS_READY.  */
+    unsigned int pa_blocked;	/* Time spent PS_BLOCKED.  */
+    unsigned int pa_switches;	/* Times it was made PS_RUNNING.  */
+} pacct_t;
+
+/* Store in `self' what the process `p' used up to its last change of
+   state, and in `children' the total of its descendants that were taken
+   out of the tree with removeChild or outChild.  Either may be NULL.  */
+void getPAcct (pcb_t *p, pacct_t *self, pacct_t *children);
+
+
 /****** Manipulating queues of processes.  ******/
 
 /* Return a pointer to the tail of an empty process queue; i.e. NULL.  */
@@ -63,9 +136,54 @@ pcb_t *outProcQ (pcbq_t **pqp, pcb_t *p);
    Return NULL if the process queue is empty. */
 pcb_t *headProcQ (pcbq_t *pq);
 
+/* Remove the head of the process queue `from' and insert it at the tail of
+   the process queue `to'.  Return NULL if `from' was empty; otherwise
+   return the moved process.  */
+pcb_t *moveProcQ (pcbq_t **from, pcbq_t **to);
+
+/* Move up to `k' processes from the head of `from' to the tail of `to',
+   keeping their order.  Return the number of processes moved.  */
+int moveProcQN (pcbq_t **from, pcbq_t **to, int k);
+
+/* Append the whole process queue `from' to the tail of `to', in constant
+   time, and leave `from' empty.  */
+void spliceProcQ (pcbq_t **from, pcbq_t **to);
+
+/* Move to the tail of `to', in order, the processes of `from' whose
+   number of requested units fits in `*avail', and subtract their requests
+   from `*avail'.  If `fair' is TRUE, stop at the first process whose
+   request does not fit, so that it is not overtaken.  Return the number
+   of processes moved.  */
+int moveProcQUnits (pcbq_t **from, pcbq_t **to, int *avail, int fair);
+
+/* Return the process following `p' in the process queue `pq', or NULL if
+   `p' is the tail of `pq'.  */
+pcb_t *nextProcQ (pcbq_t *pq, pcb_t *p);
+
+/* Get and set the number of units the process `p' is waiting for.  */
+int getPUnits (pcb_t *p);
+void setPUnits (pcb_t *p, int n);
+
+/* Get and set the semaphore on which the process `p' is blocked.  */
+semd_t *getPSema (pcb_t *p);
+void setPSema (pcb_t *p, semd_t *s);
+
+/* Return the EDF fields of the process `p'.  */
+edfnode_t *getPEdf (pcb_t *p);
+
+/* Return the address space of the process `p'.  */
+aspace_t *getPAs (pcb_t *p);
+
 
 /****** Manipulating trees of processes.  ******/
 
+/* Readers may walk the tree from any processor while it is changed, with
+   headChild and nextChild, and without locks: each change is published
+   with a single store, after the links it depends on.  A process taken
+   out of the tree still leads to its former siblings, and must be freed
+   with rcuFreePcb (see rcu.h), so that its memory is not reused while a
+   reader may be on it.  The functions that change the tree must be
+   serialized, like allocPcb and freePcb.  */
 /* Return TRUE iff the process `p' has no children.  */
 int emptyChild (pcb_t *p);
 
@@ -81,7 +199,18 @@ pcb_t *removeChild (pcb_t *p);
    If the process `p' has no parent, return NULL; otherwise, return `p'.  */
 pcb_t *outChild (pcb_t *p);
 
+/* Return the first child of the process `p', or NULL.  */
+pcb_t *headChild (pcb_t *p);
 
+/* Return the next sibling of the process `p', or NULL.  */
+pcb_t *nextChild (pcb_t *p);
+
+
+#ifdef VALIDATE
+/* Check `n' pcb's that have been handed out, continuing from where the
+   previous call stopped (see check.h).  Return the number checked.  */
+int procCheckStep (int n);
+#endif
 
 
 #ifdef DEBUG
@@ -93,7 +222,6 @@ pcb_t *getPNext(pcb_t *);
 pcb_t *getPParent(pcb_t *);
 pcb_t *getPChild(pcb_t *);
 pcb_t *getPSib(pcb_t *);
-semd_t *getPSema(pcb_t *);
 int getFreeProcessCount(void);
 
 
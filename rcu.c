@@ -0,0 +1,142 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* rcu.c --- Deferred freeing of processes taken out of the tree.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include "rcu.h"
+#include "atomic.h"
+
+/* Quiescent states passed by each processor, and whether it is online.
+ * Each processor only changes its own. */
+static volatile unsigned int CPU_QS[MAXCPU];
+static volatile int CPU_ONLINE[MAXCPU];
+
+/* Counters of the processors when the grace period in progress began. */
+static unsigned int GP_SNAP[MAXCPU];
+static int gpActive;
+
+/* Ring of the processes to free: the gpCount oldest from defHead wait
+ * for the grace period in progress, the nextCount others for the next
+ * one.  A process is in it at most once, so MAXPROC entries do. */
+static pcb_t *DEFERRED[MAXPROC];
+static int defHead;
+static int gpCount;
+static int nextCount;
+
+static rcustats_t stats;
+
+
+void initRCU(int ncpu) {
+    int i;
+
+    for (i = 0; i < MAXCPU; ++i) {
+        CPU_QS[i] = 0;
+        CPU_ONLINE[i] = i < ncpu;
+    }
+    gpActive = 0;
+    defHead = 0;
+    gpCount = 0;
+    nextCount = 0;
+    stats.rs_graces = 0;
+    stats.rs_deferred = 0;
+    stats.rs_freed = 0;
+}
+
+
+/* The barrier makes the reads of the tree done before it complete
+ * before the writer can see the new count. */
+void rcuQuiescent(void) {
+    memBarrier();
+    ++CPU_QS[cpuId()];
+}
+
+
+void rcuOffline(void) {
+    memBarrier();
+    ++CPU_QS[cpuId()];
+    CPU_ONLINE[cpuId()] = 0;
+}
+
+
+void rcuOnline(void) {
+    CPU_ONLINE[cpuId()] = 1;
+    memBarrier();
+}
+
+
+/* The processes to free are out of the tree before the counters are
+ * read: a reader that passes a quiescent state afterwards no longer
+ * sees them. */
+static void gpStart(void) {
+    int i;
+
+    memBarrier();
+    for (i = 0; i < MAXCPU; ++i)
+        GP_SNAP[i] = CPU_QS[i];
+    gpCount = nextCount;
+    nextCount = 0;
+    gpActive = 1;
+}
+
+
+/* A processor that was offline at the start, or went offline since,
+ * holds nothing either. */
+static int gpDone(void) {
+    int i;
+
+    for (i = 0; i < MAXCPU; ++i)
+        if (CPU_ONLINE[i] && CPU_QS[i] == GP_SNAP[i])
+            return 0;
+    return 1;
+}
+
+
+int rcuReclaim(void) {
+    int n = 0;
+
+    if (gpActive && gpDone()) {
+        memBarrier();
+        for (; gpCount > 0; --gpCount) {
+            freePcb(DEFERRED[defHead]);
+            if (++defHead == MAXPROC)
+                defHead = 0;
+            ++n;
+        }
+        gpActive = 0;
+        ++stats.rs_graces;
+        stats.rs_freed += n;
+    }
+
+    if (!gpActive && nextCount > 0)
+        gpStart();
+    return n;
+}
+
+
+void rcuFreePcb(pcb_t *p) {
+    int i;
+
+    if (p == NULL)
+        return;
+
+    i = (defHead + gpCount + nextCount) % MAXPROC;
+    DEFERRED[i] = p;
+    ++nextCount;
+    ++stats.rs_deferred;
+    rcuReclaim();
+}
+
+
+void rcuStats(rcustats_t *out) {
+    if (out == NULL)
+        return;
+
+    *out = stats;
+    out->rs_pending = gpCount + nextCount;
+}
@@ -0,0 +1,58 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* rcu.h --- Deferred freeing of processes taken out of the tree.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef RCU_H
+#define RCU_H
+
+#include "proc.h"
+
+/* Readers of the process tree (see headChild) take no lock, so a process
+   taken out of the tree may still be in use by a reader on another
+   processor.  It is freed only after a grace period: once every online
+   processor has called rcuQuiescent, which it does when it holds no
+   pointer into the tree, e.g. between two dispatches.  A processor that
+   goes idle calls rcuOffline so that grace periods do not wait for it.
+
+   rcuFreePcb and rcuReclaim free processes, so they must be serialized
+   with allocPcb and freePcb.  */
+
+typedef struct rcustats {
+    unsigned int rs_graces;	/* Grace periods completed.  */
+    unsigned int rs_deferred;	/* Processes given to rcuFreePcb.  */
+    unsigned int rs_freed;	/* Processes freed after a grace period.  */
+    int          rs_pending;	/* Processes waiting to be freed.  */
+} rcustats_t;
+
+/* Initialize the module: the processors 0 to `ncpu'-1 are online, and no
+   process waits to be freed.  */
+void initRCU (int ncpu);
+
+/* Tell that the current processor holds no pointer into the process
+   tree.  Constant time, and no lock.  */
+void rcuQuiescent (void);
+
+/* Take the current processor out of the grace periods, e.g. when it goes
+   idle, and put it back.  It must not read the tree while offline.  */
+void rcuOffline (void);
+void rcuOnline (void);
+
+/* Free the process `p', which is out of the process tree, once the
+   readers that may be on it are done.  */
+void rcuFreePcb (pcb_t *p);
+
+/* Free the processes whose grace period has ended, and start the next
+   one.  Return the number of processes freed.  */
+int rcuReclaim (void);
+
+/* Fill `out' with the statistics of the module.  */
+void rcuStats (rcustats_t *out);
+
+#endif
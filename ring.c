@@ -0,0 +1,147 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* ring.c --- Batched system calls through shared rings.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include "ring.h"
+
+#define RING_MASK (RING_SIZE - 1)
+
+/* The ring whose entry blocked each process, by pcbIndex. */
+static ring_t *blockedOn[MAXPROC];
+
+
+void ringInit (ring_t *r) {
+    r->r_sqHead = r->r_sqTail = 0;
+    r->r_cqHead = r->r_cqTail = 0;
+    r->r_waiting = 0;
+    r->r_waitTag = 0;
+    r->r_waitProc = NULL;
+    r->r_waitRes = 1;
+    r->r_enters = 0;
+    r->r_ops = 0;
+}
+
+
+sqe_t *ringGetSQE (ring_t *r) {
+    if (r->r_sqTail - r->r_sqHead == RING_SIZE)
+        return NULL;
+    return &r->r_sq[r->r_sqTail++ & RING_MASK];
+}
+
+
+int ringReap (ring_t *r, cqe_t *out) {
+    if (r->r_cqHead == r->r_cqTail)
+        return 0;
+    *out = r->r_cq[r->r_cqHead++ & RING_MASK];
+    return 1;
+}
+
+
+static void post (ring_t *r, unsigned int tag, int res, pcb_t *child) {
+    cqe_t *c = &r->r_cq[r->r_cqTail++ & RING_MASK];
+
+    c->cq_tag = tag;
+    c->cq_res = res;
+    c->cq_child = child;
+}
+
+
+/* Carry out the entry e for p.  Return FALSE if it blocked p; its
+ * completion is then posted by ringComplete or the next ringEnter. */
+static int carryOut (ring_t *r, sqe_t *e, pcb_t *p, pcbq_t **rq) {
+    pcb_t *c;
+    int res;
+
+    switch (e->sq_op) {
+    case RING_P:
+        res = passerenN(e->sq_sem, p, e->sq_units);
+        if (res == 0)
+            return 0;
+        post(r, e->sq_tag, res, NULL);
+        return 1;
+    case RING_V:
+        post(r, e->sq_tag, verhogenN(e->sq_sem, e->sq_units, rq), NULL);
+        return 1;
+    case RING_FORK:
+        c = allocPcb();
+        if (c != NULL) {
+            insertChild(p, c);
+            insertProcQ(rq, c);
+        }
+        post(r, e->sq_tag, c != NULL, c);
+        return 1;
+    case RING_IO:
+        if (diskSubmit(e->sq_dq, p, e->sq_cyl, e->sq_head, e->sq_sect,
+                       e->sq_count, e->sq_write, e->sq_buf))
+            return 0;
+        post(r, e->sq_tag, 0, NULL);
+        return 1;
+    default:
+        post(r, e->sq_tag, -1, NULL);
+        return 1;
+    }
+}
+
+
+/* Every entry needs a free completion before it is carried out, and
+ * the completion of an entry that blocked p comes before the others,
+ * so they stay in order. */
+int ringEnter (ring_t *r, pcb_t *p, pcbq_t **rq) {
+    unsigned int posted;
+    sqe_t *e;
+
+    if (r == NULL || p == NULL || getPState(p) == PS_BLOCKED)
+        return 0;
+
+    ++r->r_enters;
+    posted = r->r_cqTail;
+    if (r->r_waiting && r->r_cqTail - r->r_cqHead < RING_SIZE) {
+        post(r, r->r_waitTag, r->r_waitRes, NULL);
+        r->r_waiting = 0;
+        blockedOn[pcbIndex(r->r_waitProc)] = NULL;
+    }
+
+    while (!r->r_waiting && r->r_sqHead != r->r_sqTail &&
+           r->r_cqTail - r->r_cqHead < RING_SIZE) {
+        e = &r->r_sq[r->r_sqHead++ & RING_MASK];
+        ++r->r_ops;
+        if (!carryOut(r, e, p, rq)) {
+            r->r_waiting = 1;
+            r->r_waitTag = e->sq_tag;
+            r->r_waitProc = p;
+            r->r_waitRes = 1;
+            blockedOn[pcbIndex(p)] = r;
+            break;
+        }
+    }
+
+    return r->r_cqTail - posted;
+}
+
+
+int ringComplete (pcb_t *p, int res) {
+    ring_t *r;
+    int k;
+
+    if (p == NULL)
+        return 0;
+    k = pcbIndex(p);
+    r = blockedOn[k];
+    if (r == NULL || !r->r_waiting || r->r_waitProc != p)
+        return 0;
+
+    r->r_waitRes = res;
+    if (r->r_cqTail - r->r_cqHead == RING_SIZE)
+        return 0;
+    post(r, r->r_waitTag, res, NULL);
+    r->r_waiting = 0;
+    blockedOn[k] = NULL;
+    return 1;
+}
@@ -0,0 +1,114 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* ring.h --- Batched system calls through shared rings.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef RING_H
+#define RING_H
+
+#include "proc.h"
+#include "sema.h"
+#include "diskq.h"
+
+/* A process shares a ring with the kernel: it fills entries of the
+   submission queue, enters the kernel once with ringEnter for all of
+   them, and reaps their completions from the completion queue without
+   entering the kernel.
+
+   Entries are carried out in order.  An entry that blocks the process (a
+   P that cannot be granted, a transfer) ends the batch.  The kernel
+   posts its completion with ringComplete from the path that wakes the
+   process, so that the process reaps it without entering the kernel
+   again; the following entries are carried out by the next ringEnter.
+   If it was not posted by then, the next ringEnter posts it with TRUE.  */
+
+/* Number of entries of each queue; a power of two.  */
+#define RING_SIZE 16
+
+enum ring_op {
+    RING_P,			/* passerenN(sq_sem, p, sq_units).  */
+    RING_V,			/* verhogenN(sq_sem, sq_units, rq).  */
+    RING_FORK,			/* allocPcb and insertChild.  */
+    RING_IO			/* diskSubmit on sq_dq.  */
+};
+
+/* Submission queue entry.  */
+typedef struct sqe {
+    enum ring_op sq_op;
+    unsigned int sq_tag;	/* Copied to the completion.  */
+    semd_t  *sq_sem;		/* RING_P, RING_V.  */
+    int      sq_units;		/* RING_P, RING_V.  */
+    diskq_t *sq_dq;		/* RING_IO.  */
+    int      sq_cyl;		/* RING_IO.  */
+    int      sq_head;		/* RING_IO.  */
+    int      sq_sect;		/* RING_IO.  */
+    int      sq_count;		/* RING_IO.  */
+    int      sq_write;		/* RING_IO.  */
+    void    *sq_buf;		/* RING_IO.  */
+} sqe_t;
+
+/* Completion queue entry.  cq_res is TRUE for a granted RING_P and -1
+   for one refused (see passerenN), the number of processes woken for
+   RING_V, TRUE for a successful RING_FORK, the result given to
+   ringComplete for a RING_IO, FALSE for a RING_IO refused by
+   diskSubmit, and -1 for an unknown operation.  */
+typedef struct cqe {
+    unsigned int cq_tag;
+    int          cq_res;
+    pcb_t       *cq_child;	/* RING_FORK: the new process.  */
+} cqe_t;
+
+/* Counters run freely; an index is taken modulo RING_SIZE.  */
+typedef struct ring {
+    unsigned int r_sqHead;	/* Next entry the kernel carries out.  */
+    unsigned int r_sqTail;	/* Next entry the process fills.  */
+    unsigned int r_cqHead;	/* Next completion the process reaps.  */
+    unsigned int r_cqTail;	/* Next completion the kernel posts.  */
+    int          r_waiting;	/* The entry r_waitTag blocked the process.  */
+    unsigned int r_waitTag;
+    pcb_t       *r_waitProc;	/* The process it blocked.  */
+    int          r_waitRes;	/* Result given by ringComplete.  */
+    unsigned int r_enters;	/* Calls to ringEnter.  */
+    unsigned int r_ops;		/* Entries carried out.  */
+    sqe_t r_sq[RING_SIZE];
+    cqe_t r_cq[RING_SIZE];
+} ring_t;
+
+
+/****** Process side: never enters the kernel.  ******/
+
+/* Make `r' empty.  */
+void ringInit (ring_t *r);
+
+/* Return the next free entry of the submission queue of `r', which will
+   be carried out by the next ringEnter, or NULL if the queue is full.  */
+sqe_t *ringGetSQE (ring_t *r);
+
+/* Copy the oldest completion of `r' into `out' and return TRUE, or return
+   FALSE if there is none.  */
+int ringReap (ring_t *r, cqe_t *out);
+
+
+/****** Kernel side.  ******/
+
+/* Carry out the entries submitted in `r' by the process `p', as long as
+   the completion queue has room and `p' is not blocked.  Processes woken
+   or created are inserted at the tail of the process queue `rq'.  Return
+   the number of completions posted.  */
+int ringEnter (ring_t *r, pcb_t *p, pcbq_t **rq);
+
+/* Post `res' as the completion of the entry that blocked `p', from the
+   path that wakes `p': the disk interrupt handler after diskDone with
+   the status of the transfer, the V handler with TRUE.  If the
+   completion queue is full, `res' is kept and posted by the next
+   ringEnter.  Return TRUE if the completion was posted, FALSE if not or
+   if no entry blocked `p'.  */
+int ringComplete (pcb_t *p, int res);
+
+#endif
@@ -9,70 +9,309 @@ it under the terms of the GNU General Public License as published by
 the Free Software Foundation, either version 3 of the License, or
 (at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
 
+#include "umps/arch.h"
+
 #include "proc.h"
 #include "sema.h"
+#include "tod.h"
+#include "hist.h"
+#include "check.h"
+#include "atomic.h"
+#include "lat.h"
 
 
-enum semd_state { ST_FREE, ST_ACQUIRED, ST_ASL };
-
-/* Semaphore descriptor.  */
-struct semd {
-    semd_t *s_next;		/* Next element on the ASL.  */
-    int     s_value;		/* Current value of the semaphore.  */
-    pcbq_t *s_procQ;		/* Queue of blocked processes.  */
-
-    enum semd_state s_state;
-};
-
 /* The list of active semaphores,
    i.e. semaphores on which some process is blocked.  */
 static semd_t *ASL;
 static semd_t *semdFree;
 
+/* Like for PROCESS_POOL, semaphores of SEMA_POOL are handed out from
+   semdFree first, then from SEMA_POOL[semdBump..MAXPROC-1].  */
 static semd_t SEMA_POOL[MAXPROC];
+static int semdBump;
 
+/* One semaphore per external device, plus one per terminal for the
+   receive sub-device, indexed by interrupt line and device number.  */
+#define DEV_SEMA_COUNT ((N_EXT_IL + 1) * N_DEV_PER_IL)
+static semd_t DEV_SEMA[DEV_SEMA_COUNT];
 
-void initASL(void) {
+#ifdef SEMA_PROFILE
+/* Embedded semaphores on which a process has blocked, which topContended
+   could not find otherwise, through s_profNext. */
+static semd_t *profList;
+#endif
+
+
+
+/* Clear the contention statistics of s. */
+static void profReset (semd_t *s) {
+#ifdef SEMA_PROFILE
     int i;
 
-    for (i = 0; i < MAXPROC - 1; ++i) {
-        SEMA_POOL[i].s_next = &SEMA_POOL[i+1];
-        SEMA_POOL[i].s_state = ST_FREE;
+    s->s_depth = 0;
+    s->s_drained = 0;
+    s->s_prof.sp_acquires = 0;
+    s->s_prof.sp_blocks = 0;
+    s->s_prof.sp_waitTime = 0;
+    s->s_prof.sp_maxDepth = 0;
+    for (i = 0; i < HIST_BUCKETS; ++i)
+        s->s_prof.sp_hist[i] = 0;
+#endif
+}
+
+/* Take s off profList if it is on it.  Only the addresses are
+ * compared, so s may not be initialized yet. */
+static void profUnlink (semd_t *s) {
+#ifdef SEMA_PROFILE
+    semd_t **pp;
+
+    for (pp = &profList; *pp != NULL; pp = &(*pp)->s_profNext)
+        if (*pp == s) {
+            *pp = s->s_profNext;
+            return;
+        }
+#endif
+}
+
+/* Clear the spinning state and statistics of s. */
+static void spinReset (semd_t *s) {
+    s->s_spin = 0;
+    s->s_held = 0;
+    s->s_acqTOD = 0;
+    s->s_spinStats.ss_fast = 0;
+    s->s_spinStats.ss_spun = 0;
+    s->s_spinStats.ss_blocked = 0;
+    s->s_spinStats.ss_hold = 0;
+    s->s_spinStats.ss_limit = 0;
+}
+
+/* Add one to the spinning statistic at c, which semTrySpin changes
+ * without the ASL being locked. */
+static void spinCount (unsigned int *c) {
+    int v;
+
+    do
+        v = loadInt(c);
+    while (!casInt(c, v, v + 1));
+}
+
+/* Take n units of s if it has them.  The value of a spinning semaphore
+ * is changed by other processors without the ASL being locked, hence
+ * the CAS, and the start of its hold is recorded before it is marked
+ * held. */
+static int valueTake (semd_t *s, int n) {
+    int v;
+
+    if (!s->s_spin) {
+        if (s->s_value < n)
+            return 0;
+        s->s_value -= n;
+        return 1;
     }
 
-    SEMA_POOL[MAXPROC-1].s_next = NULL;
-    SEMA_POOL[MAXPROC-1].s_state = ST_FREE;
+    do {
+        v = loadInt(&s->s_value);
+        if (v < n)
+            return 0;
+    } while (!casInt(&s->s_value, v, v - n));
+
+    s->s_acqTOD = readTOD();
+    memBarrier();
+    s->s_held = 1;
+    return 1;
+}
+
+/* Give n units back to s. */
+static void valueGive (semd_t *s, int n) {
+    int v;
+
+    if (!s->s_spin) {
+        s->s_value += n;
+        return;
+    }
 
-    semdFree = &SEMA_POOL[0];
+    do
+        v = loadInt(&s->s_value);
+    while (!casInt(&s->s_value, v, v + n));
+}
+
+/* Bookkeeping for a process p that starts waiting on s. */
+static void blocked (semd_t *s, pcb_t *p) {
+    CHECK(getPSema(p) == NULL, "process blocked on two semaphores");
+    setPSema(p, s);
+    setPState(p, PS_BLOCKED);
+#ifdef SEMA_PROFILE
+    if (++s->s_prof.sp_blocks == 1 && s->s_embed) {
+        s->s_profNext = profList;
+        profList = s;
+    }
+    if (++s->s_depth > s->s_prof.sp_maxDepth)
+        s->s_prof.sp_maxDepth = s->s_depth;
+#endif
+}
+
+/* Bookkeeping for a process p that leaves s's procQ.  acquired is FALSE
+ * when p did not get the semaphore (outBlocked). */
+static void unblocked (semd_t *s, pcb_t *p, int acquired) {
+    CHECK(getPSema(p) == s, "waiter blocked on another semaphore");
+#ifdef SEMA_PROFILE
+    unsigned int waited = readTOD() - getPStateTOD(p);
+
+    --s->s_depth;
+    s->s_prof.sp_waitTime += waited;
+    histAdd(s->s_prof.sp_hist, waited);
+    if (acquired)
+        ++s->s_prof.sp_acquires;
+#endif
+#ifdef LATENCY_PROFILE
+    if (s->s_dev)
+        latWake(p, s - DEV_SEMA);
+#endif
+    setPSema(p, NULL);
+    setPState(p, PS_READY);
+}
+
+
+void initASL(void) {
+    int i;
+
+    for (i = 0; i < DEV_SEMA_COUNT; ++i) {
+        DEV_SEMA[i].s_next = NULL;
+        DEV_SEMA[i].s_value = 0;
+        DEV_SEMA[i].s_procQ = mkEmptyProcQ();
+        DEV_SEMA[i].s_fair = 1;
+        DEV_SEMA[i].s_dev = 1;
+        DEV_SEMA[i].s_perm = 1;
+        DEV_SEMA[i].s_embed = 0;
+        DEV_SEMA[i].s_state = SEMD_ACQUIRED;
+        spinReset(&DEV_SEMA[i]);
+        profReset(&DEV_SEMA[i]);
+    }
+
+    semdFree = NULL;
+    semdBump = 0;
     ASL = NULL;
+#ifdef SEMA_PROFILE
+    profList = NULL;
+#endif
 }
 
-/* Take a semd from semdFree and "give it" to s.  Return 0 if semd is
- * empty. */
-int initSemD (semd_t **s, int val) {
+/* Make s an idle semaphore of value val. */
+static void semdReset (semd_t *s, int val, int perm) {
+    s->s_procQ = mkEmptyProcQ();
+    s->s_value = val;
+    s->s_next = NULL;
+    s->s_state = SEMD_ACQUIRED;
+    s->s_fair = 1;
+    s->s_dev = 0;
+    s->s_perm = perm;
+    spinReset(s);
+    profReset(s);
+}
+
+/* Take a semd from semdFree, or a never used one from SEMA_POOL, and
+ * "give it" to s.  Return 0 if there is none left. */
+static int semdTake (semd_t **s, int val, int perm) {
     if (semdFree != NULL) {
         /* Get a semd from the free list. */
+        CHECK(semdFree->s_state == SEMD_FREE,
+              "semaphore in use is on semdFree");
         *s = semdFree;
         semdFree = semdFree->s_next;
+    }
+    else if (semdBump < MAXPROC) {
+        *s = &SEMA_POOL[semdBump++];
+    }
+    else {
+        return 0;
+    }
+
+    semdReset(*s, val, perm);
+    (*s)->s_embed = 0;
+    return 1;
+}
 
-        /* Initialize it. */
-        (*s)->s_procQ = mkEmptyProcQ();
-        (*s)->s_value = val;
-        (*s)->s_next = NULL;
-        (*s)->s_state = ST_ACQUIRED;
+
+int initSemD (semd_t **s, int val) {
+    return semdTake(s, val, 0);
+}
+
+
+int initSemDPerm (semd_t **s, int val) {
+    return semdTake(s, val, 1);
+}
+
+
+/* An embedded semaphore is permanent, so aslRemove never puts it on
+ * semdFree. */
+void initSemDEmbed (semd_t *s, int val) {
+    if (s == NULL)
+        return;
+
+    profUnlink(s);
+    semdReset(s, val, 1);
+    s->s_embed = 1;
+}
+
+
+/* Only an idle semaphore can be given back, and only one of SEMA_POOL
+ * goes on semdFree. */
+int freeSemD (semd_t *s) {
+    if (s == NULL)
+        return 0;
+    CHECK(s->s_state != SEMD_FREE, "semaphore freed twice");
+    if (s->s_dev || s->s_state != SEMD_ACQUIRED)
+        return 0;
+
+    if (s->s_embed) {
+        profUnlink(s);
+        s->s_state = SEMD_FREE;
         return 1;
     }
-    return 0;
+
+    s->s_next = semdFree;
+    s->s_state = SEMD_FREE;
+    semdFree = s;
+    return 1;
+}
+
+
+/* Device semaphores are looked up by index: compute it and check that
+ * only terminals have a second sub-device. */
+semd_t *getDevSemD (int line, int dev, int sub) {
+    int row;
+
+    if (line < DEV_IL_START || line >= N_INTERRUPT_LINES ||
+        dev < 0 || dev >= N_DEV_PER_IL)
+        return NULL;
+
+    if (sub == 0)
+        row = line - DEV_IL_START;
+    else if (sub == 1 && line == IL_TERMINAL)
+        row = N_EXT_IL;
+    else
+        return NULL;
+
+    return &DEV_SEMA[row * N_DEV_PER_IL + dev];
 }
 
 
 /* Insert the pcb p into s's procQ.  If s was not in the ASL, insert
- * it by order of its value field. */
+ * it by order of its value field.  Device semaphores are never put on
+ * the ASL. */
 void insertBlocked (semd_t *s, pcb_t *p) {
-    if (s == NULL || p == NULL || s->s_state == ST_FREE)
+    if (s == NULL || p == NULL)
+        return;
+    CHECK(s->s_state != SEMD_FREE, "blocking on a free semaphore");
+    if (s->s_state == SEMD_FREE)
         return;
+    CHECK((s->s_state == SEMD_ASL) == !emptyProcQ(s->s_procQ),
+          "semaphore state and queue disagree");
 
-    if (s->s_state == ST_ACQUIRED) {
+    if (s->s_state == SEMD_ACQUIRED && s->s_dev) {
+        s->s_state = SEMD_ASL;
+    }
+    else if (s->s_state == SEMD_ACQUIRED) {
         semd_t *curr = ASL;
         semd_t *prev = NULL;
 
@@ -101,86 +340,294 @@ void insertBlocked (semd_t *s, pcb_t *p) {
             prev->s_next = s;
         }
 
-        s->s_state = ST_ASL;
+        s->s_state = SEMD_ASL;
     }
 
     /* Add the process p to s's procQ. */
     insertProcQ(&s->s_procQ, p);
+    blocked(s, p);
+}
+
+
+
+/* Unlink s from the ASL and return it to the semdFree list.  Called
+ * once s's procQ has become empty.  A device semaphore just goes back
+ * to being idle, and a permanent one stays acquired. */
+static void aslRemove (semd_t *s) {
+    semd_t *curr = ASL;
+    semd_t *prev = NULL;
+
+    CHECK(s->s_state == SEMD_ASL && emptyProcQ(s->s_procQ),
+          "removing a semaphore with waiters from the ASL");
+    if (s->s_dev) {
+        s->s_state = SEMD_ACQUIRED;
+        return;
+    }
+
+    while (curr != NULL && curr != s) {
+        prev = curr;
+        curr = curr->s_next;
+    }
+
+    CHECK(curr != NULL, "active semaphore missing from the ASL");
+    if (curr == NULL)
+        return;
+    else if (prev == NULL)
+        ASL = curr->s_next;
+    else
+        prev->s_next = curr->s_next;
+
+    if (s->s_perm) {
+        s->s_next = NULL;
+        s->s_state = SEMD_ACQUIRED;
+        return;
+    }
+
+    /* Return s to the semdFree list. */
+    s->s_next = semdFree;
+    s->s_state = SEMD_FREE;
+    semdFree = s;
+#ifdef SEMA_PROFILE
+    s->s_drained = 1;
+#endif
 }
 
 
 
 /* Remove the head process from s's procQ and return it. */
 pcb_t *removeBlocked (semd_t *s) {
-    if (s == NULL || s->s_state == ST_FREE || s->s_state == ST_ACQUIRED)
+    pcb_t *p;
+
+    if (s == NULL || s->s_state != SEMD_ASL)
         return NULL;
 
-    pcb_t *p = removeProcQ(&s->s_procQ);
+    p = removeProcQ(&s->s_procQ);
+    unblocked(s, p, 1);
 
     /* Remove s from ASL if its procQ is now empty. */
-    if (s->s_state == ST_ASL && emptyProcQ(s->s_procQ)) {
-        semd_t *curr = ASL;
-        semd_t *prev = NULL;
-        while (curr != NULL && curr != s) {
-            curr = curr->s_next;
-            if (prev == NULL)
-                prev = ASL;
-            else
-                prev = prev->s_next;
-        }
+    if (emptyProcQ(s->s_procQ))
+        aslRemove(s);
 
-        if (prev == NULL) {
-            ASL = curr->s_next;
-        }
-        else if (curr != NULL) {
-            prev->s_next = curr->s_next;
-        }
+    return p;
+}
 
-        /* Return s to the semdFree list. */
-        s->s_next = semdFree;
-        s->s_state = ST_FREE;
-        semdFree = s;
-    }
+
+/* Move the head process of s's procQ straight to the tail of rq. */
+pcb_t *moveBlocked (semd_t *s, pcbq_t **rq) {
+    pcb_t *p;
+
+    if (s == NULL || s->s_state != SEMD_ASL)
+        return NULL;
+
+    p = moveProcQ(&s->s_procQ, rq);
+    if (p != NULL)
+        unblocked(s, p, 1);
+
+    if (emptyProcQ(s->s_procQ))
+        aslRemove(s);
 
     return p;
 }
 
 
-/* Given a process, remove it from its semaphore's queue and return
- * it. */
-pcb_t *outBlocked (pcb_t *p) {
-    pcb_t *ret = NULL;
-    semd_t *curr = ASL;
-    semd_t *prev = NULL;
+/* Move up to k processes of s's procQ to rq with a single splice; the
+ * ASL is only looked at once, if s's procQ becomes empty. */
+int moveBlockedN (semd_t *s, pcbq_t **rq, int k) {
+    pcb_t *p;
+    int n;
+
+    if (s == NULL || s->s_state != SEMD_ASL || rq == NULL)
+        return 0;
+
+    p = headProcQ(s->s_procQ);
+    for (n = 0; n < k && p != NULL; ++n) {
+        unblocked(s, p, 1);
+        p = nextProcQ(s->s_procQ, p);
+    }
+
+    n = moveProcQN(&s->s_procQ, rq, k);
+
+    if (emptyProcQ(s->s_procQ))
+        aslRemove(s);
+
+    return n;
+}
+
+
+/* Take n units of s if they are available (and, in fair mode, nobody
+ * is waiting before p); otherwise block p until a V covers its
+ * request. */
+int passerenN (semd_t *s, pcb_t *p, int n) {
+    if (s == NULL || p == NULL || s->s_state == SEMD_FREE || n < 0)
+        return -1;
+
+    if ((!s->s_fair || emptyProcQ(s->s_procQ)) && valueTake(s, n)) {
+#ifdef SEMA_PROFILE
+        ++s->s_prof.sp_acquires;
+#endif
+        return 1;
+    }
+
+    setPUnits(p, n);
+    insertBlocked(s, p);
+    return 0;
+}
+
+
+/* Give back n units to s, then hand out as many as possible to the
+ * waiters in a single sweep of s's procQ. */
+int verhogenN (semd_t *s, int n, pcbq_t **rq) {
+    pcbq_t *old;
+    pcb_t *p;
+    int avail;
+    int woken;
+    int i;
+
+    if (s == NULL || s->s_state == SEMD_FREE || n < 0 || rq == NULL)
+        return 0;
 
-    /* Find the semaphore containing p. */
-    while (curr != NULL) {
-        ret = outProcQ(&curr->s_procQ, p);
-        if (ret != NULL)
+    if (s->s_spin && casInt(&s->s_held, 1, 0)) {
+        /* The hold that ends now tunes the spin. */
+        unsigned int hold = readTOD() - s->s_acqTOD;
+        unsigned int avg;
+
+        do
+            avg = loadInt(&s->s_spinStats.ss_hold);
+        while (!casInt(&s->s_spinStats.ss_hold, avg,
+                       avg + hold / 8 - avg / 8));
+    }
+
+    valueGive(s, n);
+    if (s->s_state != SEMD_ASL)
+        return 0;
+
+    /* Spinners change the value of a spinning semaphore with a CAS: the
+       units to hand out are taken all at once, and what is left is given
+       back. */
+    old = *rq;
+    if (s->s_spin) {
+        do
+            avail = loadInt(&s->s_value);
+        while (!casInt(&s->s_value, avail, 0));
+        woken = moveProcQUnits(&s->s_procQ, rq, &avail, s->s_fair);
+        valueGive(s, avail);
+    }
+    else
+        woken = moveProcQUnits(&s->s_procQ, rq, &s->s_value, s->s_fair);
+    if (woken > 0 && s->s_spin) {
+        s->s_acqTOD = readTOD();
+        memBarrier();
+        s->s_held = 1;
+    }
+
+    /* The woken processes are the ones after the old tail of rq. */
+    p = old == NULL ? headProcQ(*rq) : nextProcQ(*rq, old);
+    for (i = 0; i < woken; ++i) {
+        unblocked(s, p, 1);
+        p = nextProcQ(*rq, p);
+    }
+
+    if (emptyProcQ(s->s_procQ))
+        aslRemove(s);
+
+    return woken;
+}
+
+
+void setSemFair (semd_t *s, int fair) {
+    if (s != NULL)
+        s->s_fair = fair;
+}
+
+
+void setSemSpin (semd_t *s, int spin) {
+    if (s != NULL)
+        s->s_spin = spin;
+}
+
+
+/* Spinning for twice the average hold time catches most releases, but
+ * a semaphore that is usually held longer than blocking costs is not
+ * spun on at all. */
+static unsigned int spinLimit (semd_t *s) {
+    unsigned int hold = s->s_spinStats.ss_hold;
+
+    return hold <= SEM_SPIN_MAX ? 2 * hold : 0;
+}
+
+
+/* Only the value of s is changed, with CAS, and its queue is only
+ * peeked at: this runs without the ASL being locked. */
+int semTrySpin (semd_t *s) {
+    unsigned int start;
+    unsigned int limit;
+
+    if (s == NULL || s->s_state == SEMD_FREE || !s->s_spin)
+        return 0;
+
+    if (emptyProcQ(loadPtr(&s->s_procQ)) && valueTake(s, 1)) {
+        spinCount(&s->s_spinStats.ss_fast);
+        return 1;
+    }
+
+    /* In fair mode, a spinner must not get ahead of the waiters. */
+    if (s->s_fair && !emptyProcQ(loadPtr(&s->s_procQ)))
+        return 0;
+    limit = spinLimit(s);
+    start = readTOD();
+    while (readTOD() - start < limit) {
+        if (s->s_fair && !emptyProcQ(loadPtr(&s->s_procQ)))
             break;
-        curr = curr->s_next;
-        if (prev == NULL)
-            prev = ASL;
-        else
-            prev = prev->s_next;
-    }
-
-    /* Remove p's containing semaphore from ASL if its procQ is now empty. */
-    if (ret != NULL) {
-        if (curr->s_state == ST_ASL && emptyProcQ(curr->s_procQ)) {
-            if (prev == NULL) {
-                ASL = curr->s_next;
-            }
-            else if (curr != NULL) {
-                prev->s_next = curr->s_next;
-            }
+        if (loadInt(&s->s_value) > 0 && valueTake(s, 1)) {
+            spinCount(&s->s_spinStats.ss_spun);
+            return 1;
         }
-        curr->s_next = semdFree;
-        semdFree = curr;
-        curr->s_state = ST_FREE;
     }
+    return 0;
+}
+
+
+/* With the ASL locked, a verhogenN either came before the value is
+ * checked again by passerenN, or finds p on the queue of s. */
+int passerenSpin (semd_t *s, pcb_t *p) {
+    int res = passerenN(s, p, 1);
+
+    if (res >= 0 && s->s_spin)
+        spinCount(res ? &s->s_spinStats.ss_spun : &s->s_spinStats.ss_blocked);
+    return res;
+}
+
+
+int getSemSpin (semd_t *s, semspin_t *out) {
+    if (s == NULL || out == NULL || s->s_state == SEMD_FREE)
+        return 0;
+
+    *out = s->s_spinStats;
+    out->ss_limit = spinLimit(s);
+    return 1;
+}
+
+
+/* Given a process, remove it from the queue of the semaphore it is
+ * blocked on and return it. */
+pcb_t *outBlocked (pcb_t *p) {
+    semd_t *s;
 
-    return ret;
+    if (p == NULL)
+        return NULL;
+
+    s = getPSema(p);
+    if (s == NULL || s->s_state != SEMD_ASL ||
+        outProcQ(&s->s_procQ, p) == NULL)
+        return NULL;
+
+    unblocked(s, p, 0);
+
+    /* Remove p's semaphore from ASL if its procQ is now empty. */
+    if (emptyProcQ(s->s_procQ))
+        aslRemove(s);
+
+    return p;
 }
 
 
@@ -195,10 +642,109 @@ pcb_t *headBlocked (semd_t *s) {
 
 
 
+
+#ifdef VALIDATE
+/* Position of the next semaphore to check, counting the semaphores of
+   SEMA_POOL that have been handed out, then DEV_SEMA. */
+static int checkNext;
+
+/* A semaphore is in state SEMD_ASL exactly when it has waiters, and only
+   such semaphores are linked on the ASL. */
+static void checkSemd (semd_t *s) {
+    CHECK((s->s_state == SEMD_ASL) == !emptyProcQ(s->s_procQ),
+          "semaphore state and queue disagree");
+    CHECK(s->s_state != SEMD_ACQUIRED || s->s_next == NULL,
+          "idle semaphore is linked");
+    CHECK(s->s_state != SEMD_ASL || s->s_next == NULL ||
+          s->s_next->s_state == SEMD_ASL,
+          "ASL links an inactive semaphore");
+    CHECK(s->s_state != SEMD_FREE || s->s_next == NULL ||
+          s->s_next->s_state == SEMD_FREE,
+          "semdFree links a semaphore in use");
+    CHECK(emptyProcQ(s->s_procQ) || getPSema(headProcQ(s->s_procQ)) == s,
+          "waiter blocked on another semaphore");
+}
+
+
+int semaCheckStep (int n) {
+    int i;
+
+    for (i = 0; i < n && i < semdBump + DEV_SEMA_COUNT; ++i) {
+        if (checkNext >= semdBump + DEV_SEMA_COUNT)
+            checkNext = 0;
+        if (checkNext < semdBump)
+            checkSemd(&SEMA_POOL[checkNext]);
+        else
+            checkSemd(&DEV_SEMA[checkNext - semdBump]);
+        ++checkNext;
+    }
+
+    return i;
+}
+#endif
+
+
+#ifdef SEMA_PROFILE
+int getSemProf (semd_t *s, semprof_t *out) {
+    if (s == NULL || out == NULL ||
+        (s->s_state == SEMD_FREE && !s->s_drained))
+        return 0;
+
+    *out = s->s_prof;
+    return 1;
+}
+
+
+/* Insert s into the array top of length *len, sorted by decreasing
+ * wait time and holding at most n entries. */
+static void topInsert (semd_t **top, int *len, int n, semd_t *s) {
+    int i;
+
+    if ((s->s_state == SEMD_FREE && !s->s_drained) ||
+        s->s_prof.sp_blocks == 0)
+        return;
+
+    i = *len < n ? (*len)++ : n;
+    while (i > 0 && top[i-1]->s_prof.sp_waitTime < s->s_prof.sp_waitTime) {
+        if (i < n)
+            top[i] = top[i-1];
+        --i;
+    }
+    if (i < n)
+        top[i] = s;
+}
+
+
+/* Scan every semaphore that may be in use, keeping the n worst.  The
+ * embedded ones are only known through profList. */
+int topContended (semd_t **out, int n) {
+    semd_t *s;
+    int len = 0;
+    int i;
+
+    if (out == NULL || n <= 0)
+        return 0;
+
+    for (i = 0; i < semdBump; ++i)
+        topInsert(out, &len, n, &SEMA_POOL[i]);
+    for (i = 0; i < DEV_SEMA_COUNT; ++i)
+        topInsert(out, &len, n, &DEV_SEMA[i]);
+    for (s = profList; s != NULL; s = s->s_profNext)
+        topInsert(out, &len, n, s);
+
+    return len;
+}
+#endif
+
+
 #ifdef DEBUG
 semd_t *getSema(int i) {return &SEMA_POOL[i];}
 semd_t *getASL(void) {return ASL;}
-semd_t *getSemdFree(void) {return semdFree;}
+semd_t *getSemdFree(void) {
+    if (semdFree != NULL || semdBump == MAXPROC)
+        return semdFree;
+    return &SEMA_POOL[semdBump];
+}
 semd_t *getSNext(semd_t *s) { return s->s_next; }
 int     getSValue(semd_t *s) { return s->s_value; }
 pcbq_t *getSProcQ(semd_t *s) { return s->s_procQ; }
@@ -13,10 +13,71 @@ the Free Software Foundation, either version 3 of the License, or
 #define SEMA_H
 
 typedef struct pcb pcb_t;	/* Copied from proc.h.  */
+typedef pcb_t pcbq_t;
 
-/* The type of semaphore objects.  */
 typedef struct semd semd_t;
 
+#ifdef SEMA_PROFILE
+#include "hist.h"
+
+/* Contention statistics of a semaphore, kept when compiled with
+   -DSEMA_PROFILE.  Times are in TOD ticks.  */
+typedef struct semprof {
+    unsigned int sp_acquires;	/* Times the semaphore was acquired.  */
+    unsigned int sp_blocks;	/* Times a process blocked on it.  */
+    unsigned int sp_waitTime;	/* Total time spent blocked on it.  */
+    int          sp_maxDepth;	/* Longest queue of blocked processes.  */
+    unsigned int sp_hist[HIST_BUCKETS];	/* Log-scale wait times.  */
+} semprof_t;
+#endif
+
+/* Outcome of the acquisitions of a semaphore through semTrySpin and
+   passerenSpin.  */
+typedef struct semspin {
+    unsigned int ss_fast;	/* Acquired at once.  */
+    unsigned int ss_spun;	/* Acquired after spinning.  */
+    unsigned int ss_blocked;	/* Blocked after spinning in vain.  */
+    unsigned int ss_hold;	/* Average hold time, in TOD ticks.  */
+    unsigned int ss_limit;	/* Current spin limit, in TOD ticks.  */
+} semspin_t;
+
+/* A semaphore usually held for longer than this many TOD ticks is not
+   worth spinning on: blocking is cheaper.  */
+#ifndef SEM_SPIN_MAX
+#define SEM_SPIN_MAX 1000
+#endif
+
+/* A device semaphore with waiters is in state SEMD_ASL even though it is
+   found through getDevSemD rather than on the ASL.  */
+enum semd_state { SEMD_FREE, SEMD_ACQUIRED, SEMD_ASL };
+
+/* The type of semaphore objects.  It is public so that semaphores can be
+   embedded in the structures that use them (see initSemDEmbed), but its
+   fields are only for sema.c.  */
+struct semd {
+    semd_t *s_next;		/* Next element on the ASL.  */
+    int     s_value;		/* Current value of the semaphore.  */
+    pcbq_t *s_procQ;		/* Queue of blocked processes.  */
+    int     s_fair;		/* Wake multi-unit waiters in FIFO order.  */
+    int     s_dev;		/* Part of DEV_SEMA, never freed.  */
+    int     s_perm;		/* Kept when s_procQ drains.  */
+    int     s_embed;		/* In the memory of the caller.  */
+
+    int          s_spin;	/* Spin in semTrySpin.  */
+    int          s_held;	/* Acquired since the last verhogenN.  */
+    unsigned int s_acqTOD;	/* When it was last acquired.  */
+    semspin_t    s_spinStats;
+
+    enum semd_state s_state;
+
+#ifdef SEMA_PROFILE
+    int       s_depth;		/* Current length of s_procQ.  */
+    int       s_drained;	/* Given back as its queue drained.  */
+    semd_t   *s_profNext;	/* Next embedded semaphore with blocks.  */
+    semprof_t s_prof;
+#endif
+};
+
 /****** General manipulation of semaphore objects.  ******/
 
 /* Initialize the semaphore module.  */
@@ -25,6 +86,30 @@ void initASL (void);
 /* Initialize a new semaphore object `s'.  `val' is its initial value.  */
 int initSemD (semd_t **s, int val);
 
+/* Like initSemD, but the semaphore is not given back when its last blocked
+   process is removed: it stays acquired until freeSemD is called.  Use it
+   for semaphores embedded in longer-lived objects such as locks.  */
+int initSemDPerm (semd_t **s, int val);
+
+/* Initialize the semaphore `s', in memory of the caller's (a static
+   variable, a field of a lock...), with the value `val'.  It never runs
+   out, and it is only linked on the ASL while processes are blocked on
+   it.  Like the semaphores of initSemDPerm, it stays in use until
+   freeSemD is called.  */
+void initSemDEmbed (semd_t *s, int val);
+
+/* Give back the semaphore `s', which must have no blocked process.  Return
+   FALSE if `s' could not be freed.  An embedded semaphore is only marked
+   free, and its memory is the caller's again.  */
+int freeSemD (semd_t *s);
+
+/* Return the semaphore of the device `dev' on the interrupt line `line'.
+   `sub' selects the sub-device: 0, or 1 for the receiver of a terminal.
+   Device semaphores exist from initASL on, start at 0, are never freed and
+   are not kept on the ASL, so finding and waking their waiters takes
+   constant time.  Return NULL if there is no such device.  */
+semd_t *getDevSemD (int line, int dev, int sub);
+
 /* Insert the process `p' at the tail of the queue of semaphore `s'.
    Add `s' to the ASL (active semaphore list), if not done yet.  */
 void insertBlocked (semd_t *s, pcb_t *p);
@@ -35,6 +120,68 @@ void insertBlocked (semd_t *s, pcb_t *p);
    remove the semaphore from the ASL. */
 pcb_t *removeBlocked (semd_t *s);
 
+/* Like removeBlocked, but insert the removed process at the tail of the
+   process queue `rq' (e.g. a ready queue) in the same operation.  */
+pcb_t *moveBlocked (semd_t *s, pcbq_t **rq);
+
+/* Move up to `k' processes from the head of the queue of the semaphore
+   `s' to the tail of the process queue `rq', keeping their order.
+   Remove `s' from the ASL if its queue becomes empty.  Return the
+   number of processes moved.  */
+int moveBlockedN (semd_t *s, pcbq_t **rq, int k);
+
+/* Acquire `n' units of the semaphore `s' for the process `p'.  Return
+   TRUE if the units were granted.  Otherwise `p' is blocked on `s' until a
+   verhogenN hands it the `n' units, and FALSE is returned.  Return -1,
+   and leave `p' as it is, if `s' is not in use or `n' is negative.  */
+int passerenN (semd_t *s, pcb_t *p, int n);
+
+/* Release `n' units of the semaphore `s'.  Waiters whose request can now
+   be granted are removed from the queue of `s' in one sweep and inserted
+   at the tail of the process queue `rq'.  Return the number of processes
+   woken.  */
+int verhogenN (semd_t *s, int n, pcbq_t **rq);
+
+/* Choose how multi-unit waiters of `s' are woken.  If `fair' is TRUE (the
+   default), waiters are served strictly in FIFO order, so a large request
+   is never overtaken by smaller ones.  Otherwise any waiter whose request
+   fits is woken.  */
+void setSemFair (semd_t *s, int fair);
+
+/* Make semTrySpin spin on `s' if `spin' is TRUE.  Meant for semaphores
+   used as locks, which are held for a short time on another processor:
+   the time between an acquisition and the next verhogenN is recorded to
+   tune the spin.  */
+void setSemSpin (semd_t *s, int spin);
+
+/* Acquiring a unit of a spinning semaphore takes two steps:
+
+       if (!semTrySpin(s)) {
+           lock the semaphores;
+           granted = passerenSpin(s, p);
+           unlock the semaphores;
+       }
+
+   semTrySpin takes a unit of `s' if it is free.  Otherwise it waits for
+   `s' to be released, for about twice its average hold time; in fair
+   mode, only while no process waits on `s'.  It only reads and changes
+   the value of `s', with CAS, so it must be called without the lock
+   that serializes the other operations on `s': a verhogenN could not
+   release `s' meanwhile.  Return TRUE if the unit was taken, and FALSE
+   at once if `s' does not spin.  */
+int semTrySpin (semd_t *s);
+
+/* The second step: acquire one unit of `s' for `p' like passerenN, with
+   the operations on `s' serialized.  The value is checked again before
+   `p' is blocked, so a release that came after semTrySpin gave up is not
+   lost, and any later verhogenN finds `p' on the queue.  The outcome is
+   counted in the spinning statistics of `s'.  */
+int passerenSpin (semd_t *s, pcb_t *p);
+
+/* Copy the spinning statistics of `s' into `out'.  Return FALSE if `s'
+   is not in use.  */
+int getSemSpin (semd_t *s, semspin_t *out);
+
 /* Remove the process `p' from the queue of the semaphore for which `p'
    is waiting.  Return NULL if `p' is not waiting for a semaphore and
    `p' otherwise.  */
@@ -46,6 +193,28 @@ pcb_t *headBlocked (semd_t *s);
 
 
 
+#ifdef SEMA_PROFILE
+/* Copy the statistics of the semaphore `s' into `out'.  Return FALSE if
+   `s' is not in use.  A semaphore of initSemD that was given back when
+   its queue drained keeps its statistics until it is handed out
+   again.  */
+int getSemProf (semd_t *s, semprof_t *out);
+
+/* Fill `out' with at most `n' semaphores on which processes have blocked,
+   by decreasing total wait time: the semaphores getSemProf reports on,
+   embedded ones included until freeSemD.  Return the number of
+   semaphores stored.  */
+int topContended (semd_t **out, int n);
+#endif
+
+
+#ifdef VALIDATE
+/* Check `n' semaphores, continuing from where the previous call stopped
+   (see check.h).  Return the number checked.  */
+int semaCheckStep (int n);
+#endif
+
+
 #ifdef DEBUG
 semd_t *getSema(int);
 semd_t *getASL(void);
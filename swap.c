@@ -0,0 +1,604 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* swap.c --- Demand paging to a disk.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include "swap.h"
+#include "sema.h"
+#include "page.h"
+#include "tod.h"
+
+/* Bits of the page table entries of paged pages, which the TLB ignores.
+ * An invalid entry holds the slot of the page or the index of its frame
+ * in place of the frame number.  Every entry is AS_PAGED as well, as
+ * frames and slots have a single owner: asFork does not share them. */
+#define SW_ZERO     0x00000002	/* Not on the disk yet: zeros.  */
+#define SW_SWAPPED  0x00000004	/* On the disk only.  */
+#define SW_RESIDENT 0x00000008	/* Holds the index of its frame.  */
+#define SW_WRITE    0x00000010	/* The page may be written.  */
+
+enum frame_state { FS_FREE, FS_USED, FS_PAGEIN, FS_PAGEOUT };
+
+/* Frame of the frame table.  While its page is mapped, whether it is
+ * dirty is in the page table entry; f_dirty gets it when it is
+ * unmapped. */
+typedef struct sframe {
+    unsigned int     f_addr;
+    enum frame_state f_state;
+    aspace_t        *f_as;	/* Owner of the page, or NULL.  */
+    unsigned int     f_vaddr;
+    int              f_slot;	/* Slot of the page.  */
+    int              f_write;
+    int              f_dirty;	/* Differs from the copy in f_slot.  */
+    semd_t           f_wait;	/* Processes waiting for the transfer.  */
+} sframe_t;
+
+static sframe_t FRAME[SWAP_MAXFRAMES];
+static int nFrames;
+static int hand;
+
+/* Whether each slot is taken, and the frame it is being transferred
+ * to or from, or -1.  Each page keeps its slot from swapReserve on. */
+static int SLOT_USED[SWAP_MAXSLOTS];
+static int SLOT_FRAME[SWAP_MAXSLOTS];
+static int slotNext;		/* Where the next search starts.  */
+
+/* Dirty frames waiting to be written back by the pager. */
+static int BATCH[SWAP_BATCH];
+static int batchLen;
+static pcb_t *pager;
+static int pagerBusy;
+
+static swaparea_t area;
+static int readAheadMax;
+
+/* For each process: when its blocking fault began, the frame to map
+ * when its read completes or -1, whether it was a write, and where the
+ * next fault of a sequential scan falls, with the read-ahead window. */
+static unsigned int FAULT_TOD[MAXPROC];
+static int FAULT_FRAME[MAXPROC];
+static int FAULT_WRITE[MAXPROC];
+static unsigned int SEQ_NEXT[MAXPROC];
+static int SEQ_WIN[MAXPROC];
+
+static swapstats_t stats;
+
+
+/* Runs before the hook of as.c, which would drop the paged entries. */
+static void swapForget(pcb_t *p) {
+    swapRelease(getPAs(p));
+}
+
+
+int initSwap(swaparea_t *a, pcb_t *p, int nframes) {
+    int i;
+
+    addFreeHook(swapForget);
+    area = *a;
+    if (area.sa_slots > SWAP_MAXSLOTS)
+        area.sa_slots = SWAP_MAXSLOTS;
+    pager = p;
+    pagerBusy = 0;
+    batchLen = 0;
+    hand = 0;
+    slotNext = 0;
+    readAheadMax = SWAP_READAHEAD;
+
+    for (nFrames = 0; nFrames < nframes && nFrames < SWAP_MAXFRAMES;
+         ++nFrames) {
+        sframe_t *f = &FRAME[nFrames];
+
+        f->f_addr = allocPage();
+        if (f->f_addr == 0)
+            break;
+        f->f_state = FS_FREE;
+        f->f_as = NULL;
+        f->f_slot = -1;
+        initSemDEmbed(&f->f_wait, 0);
+    }
+    for (i = 0; i < SWAP_MAXSLOTS; ++i) {
+        SLOT_USED[i] = 0;
+        SLOT_FRAME[i] = -1;
+    }
+    for (i = 0; i < MAXPROC; ++i) {
+        FAULT_FRAME[i] = -1;
+        SEQ_NEXT[i] = 0;
+        SEQ_WIN[i] = 1;
+    }
+    for (i = 0; i < HIST_BUCKETS; ++i)
+        stats.sw_latency[i] = 0;
+    stats.sw_major = stats.sw_minor = stats.sw_zero = 0;
+    stats.sw_pageIns = stats.sw_readAhead = stats.sw_pageOuts = 0;
+    stats.sw_batches = stats.sw_frameWaits = stats.sw_maxLatency = 0;
+    return nFrames;
+}
+
+
+void swapSetReadAhead(int pages) {
+    readAheadMax = pages < 1 ? 1 : pages;
+}
+
+
+/****** Slots.  ******/
+
+/* Slots are the sectors of the swap area, track by track. */
+static int slotSector(int slot) {
+    return area.sa_cyl * area.sa_heads * area.sa_sects + slot;
+}
+
+static void slotPlace(int slot, int *cyl, int *head, int *sect) {
+    int s = slotSector(slot);
+
+    *cyl = s / (area.sa_heads * area.sa_sects);
+    *head = (s / area.sa_sects) % area.sa_heads;
+    *sect = s % area.sa_sects;
+}
+
+/* Return the number of slots from slot to the end of its track. */
+static int slotTrackLeft(int slot) {
+    return area.sa_sects - slotSector(slot) % area.sa_sects;
+}
+
+static void slotFree(int slot) {
+    if (slot >= 0)
+        SLOT_USED[slot] = 0;
+}
+
+/* Return the first free slot from slotNext on, or -1, so that pages
+ * reserved one after the other get slots one after the other. */
+static int slotAlloc(void) {
+    int s, i;
+
+    for (i = 0; i < area.sa_slots; ++i) {
+        s = (slotNext + i) % area.sa_slots;
+        if (!SLOT_USED[s]) {
+            SLOT_USED[s] = 1;
+            slotNext = (s + 1) % area.sa_slots;
+            return s;
+        }
+    }
+    return -1;
+}
+
+
+int swapReserve(aspace_t *as, unsigned int vaddr, int writable) {
+    unsigned int pte;
+    int slot;
+
+    vaddr &= AS_VPN_MASK;
+    if (as == NULL ||
+        (vaddr - AS_KUSEG_START >= (AS_NPTE - 1) * PAGESIZE &&
+         vaddr != AS_KUSEG_STACK - PAGESIZE))
+        return 0;
+
+    pte = asEntryLo(as, vaddr);
+    if (pte & (SW_ZERO | SW_SWAPPED))
+        slot = pte >> 12;
+    else if ((slot = slotAlloc()) < 0)
+        return 0;
+    asSetPte(as, vaddr, (slot << 12) | AS_PAGED | SW_ZERO |
+             (writable ? SW_WRITE : 0));
+    return 1;
+}
+
+
+/****** Frames.  ******/
+
+static unsigned int framePte(sframe_t *f) {
+    return asEntryLo(f->f_as, f->f_vaddr);
+}
+
+/* Map the page of frame i, for writing if dirty. */
+static void frameMap(int i, int dirty) {
+    sframe_t *f = &FRAME[i];
+
+    pageRef(f->f_addr);
+    asSetPte(f->f_as, f->f_vaddr, f->f_addr | AS_VALID | AS_PAGED |
+             (f->f_write ? SW_WRITE : 0) | (dirty ? AS_DIRTY : 0));
+}
+
+/* Leave the page of frame i in it, but unmapped, so that its next use
+ * faults. */
+static void frameUnmap(int i) {
+    sframe_t *f = &FRAME[i];
+    unsigned int pte = framePte(f);
+
+    if (pte & AS_DIRTY)
+        f->f_dirty = 1;
+    asSetPte(f->f_as, f->f_vaddr, (i << 12) | AS_PAGED | SW_RESIDENT |
+             (f->f_write ? SW_WRITE : 0));
+}
+
+/* The page of frame i, clean and unmapped, is left on the disk only. */
+static void frameEvict(int i) {
+    sframe_t *f = &FRAME[i];
+
+    asSetPte(f->f_as, f->f_vaddr, (f->f_slot << 12) | AS_PAGED |
+             SW_SWAPPED | (f->f_write ? SW_WRITE : 0));
+    f->f_state = FS_FREE;
+    f->f_as = NULL;
+}
+
+static void frameZero(int i) {
+    unsigned int *w = (unsigned int *) (unsigned long) FRAME[i].f_addr;
+    int k;
+
+    for (k = 0; k < PAGESIZE / (int) sizeof(*w); ++k)
+        w[k] = 0;
+}
+
+
+/* Count the wait of p, woken now. */
+static void latency(pcb_t *p) {
+    unsigned int d = readTOD() - FAULT_TOD[pcbIndex(p)];
+
+    histAdd(stats.sw_latency, d);
+    if (d > stats.sw_maxLatency)
+        stats.sw_maxLatency = d;
+}
+
+static int frameWake(int i, pcbq_t **rq) {
+    pcb_t *p;
+    int n = 0;
+
+    while ((p = moveBlocked(&FRAME[i].f_wait, rq)) != NULL) {
+        latency(p);
+        ++n;
+    }
+    return n;
+}
+
+
+/****** Write-back.  ******/
+
+static void batchSort(void) {
+    int i, j, x;
+
+    for (i = 1; i < batchLen; ++i) {
+        x = BATCH[i];
+        for (j = i; j > 0 && FRAME[BATCH[j-1]].f_slot > FRAME[x].f_slot; --j)
+            BATCH[j] = BATCH[j-1];
+        BATCH[j] = x;
+    }
+}
+
+/* Write the pages of the batch with the first slots, as many as are in a
+ * row on one track, in one transfer of the pager.  Only one is in
+ * flight: the rest of the batch goes next. */
+static void batchFlush(void) {
+    int cyl, head, sect;
+    int slot, n, i;
+
+    if (pagerBusy || batchLen == 0)
+        return;
+
+    batchSort();
+    slot = FRAME[BATCH[0]].f_slot;
+    for (n = 1; n < batchLen && n < slotTrackLeft(slot) &&
+             FRAME[BATCH[n]].f_slot == slot + n; ++n)
+        ;
+
+    for (i = 0; i < n; ++i)
+        SLOT_FRAME[slot + i] = BATCH[i];
+    for (i = n; i < batchLen; ++i)
+        BATCH[i - n] = BATCH[i];
+    batchLen -= n;
+
+    slotPlace(slot, &cyl, &head, &sect);
+    diskSubmit(area.sa_dq, pager, cyl, head, sect, n, 1, NULL);
+    pagerBusy = 1;
+    ++stats.sw_batches;
+}
+
+/* While a full batch waits for the pager, dirty frames are left as they
+ * are until the hand comes back. */
+static void batchAdd(int i) {
+    if (batchLen == SWAP_BATCH)
+        return;
+    FRAME[i].f_state = FS_PAGEOUT;
+    BATCH[batchLen++] = i;
+    if (batchLen == SWAP_BATCH)
+        batchFlush();
+}
+
+/* A frame queued for write-back may sit in a partial batch, which
+ * nothing else submits while the pager is idle: submit it now. */
+static int frameWait(int i, pcb_t *p) {
+    if (FRAME[i].f_state == FS_PAGEOUT)
+        batchFlush();
+    insertBlocked(&FRAME[i].f_wait, p);
+    FAULT_TOD[pcbIndex(p)] = readTOD();
+    FAULT_FRAME[pcbIndex(p)] = -1;
+    ++stats.sw_frameWaits;
+    return 0;
+}
+
+
+/* Advance the hand until a frame can be reused: a free one, or the one
+ * of a clean page not used since the hand last passed.  Return its
+ * index, or -1 after two turns, once the dirty pages met are being
+ * written back. */
+static int clockVictim(void) {
+    sframe_t *f;
+    int n, i;
+
+    for (n = 0; n < 2 * nFrames; ++n) {
+        i = hand;
+        hand = (hand + 1) % nFrames;
+        f = &FRAME[i];
+
+        if (f->f_state == FS_FREE)
+            return i;
+        if (f->f_state != FS_USED)
+            continue;
+        if (framePte(f) & AS_VALID)
+            frameUnmap(i);
+        else if (f->f_dirty)
+            batchAdd(i);
+        else {
+            frameEvict(i);
+            return i;
+        }
+    }
+
+    batchFlush();
+    return -1;
+}
+
+/* Return a frame in transit, to wait for, or -1. */
+static int frameBusy(void) {
+    int i;
+
+    for (i = 0; i < nFrames; ++i)
+        if (FRAME[i].f_state == FS_PAGEOUT || FRAME[i].f_state == FS_PAGEIN)
+            return i;
+    return -1;
+}
+
+
+/****** Faults.  ******/
+
+static void frameTake(int i, aspace_t *as, unsigned int vaddr,
+                      unsigned int pte) {
+    sframe_t *f = &FRAME[i];
+
+    f->f_as = as;
+    f->f_vaddr = vaddr;
+    f->f_write = (pte & SW_WRITE) != 0;
+    f->f_dirty = 0;
+    f->f_slot = pte >> 12;
+}
+
+/* Read the page of frame i from slot, without mapping it yet. */
+static void frameReading(int i, int slot) {
+    sframe_t *f = &FRAME[i];
+
+    f->f_state = FS_PAGEIN;
+    SLOT_FRAME[slot] = i;
+    asSetPte(f->f_as, f->f_vaddr, (i << 12) | AS_PAGED | SW_RESIDENT |
+             (f->f_write ? SW_WRITE : 0));
+}
+
+/* A fault on the page where the previous read of p ended doubles its
+ * window; any other starts again from one page.  The pages read ahead
+ * must be the ones after vaddr on the disk as well, on the same track,
+ * and get a frame without waiting. */
+static int readAhead(pcb_t *p, aspace_t *as, unsigned int vaddr, int slot) {
+    int k = pcbIndex(p);
+    unsigned int v, pte;
+    int n, i;
+
+    if (vaddr == SEQ_NEXT[k])
+        SEQ_WIN[k] = 2 * SEQ_WIN[k] < readAheadMax ?
+            2 * SEQ_WIN[k] : readAheadMax;
+    else
+        SEQ_WIN[k] = 1;
+
+    for (n = 1; n < SEQ_WIN[k] && n < slotTrackLeft(slot); ++n) {
+        v = vaddr + n * PAGESIZE;
+        pte = asEntryLo(as, v);
+        if (!(pte & SW_SWAPPED) || (int) (pte >> 12) != slot + n)
+            break;
+        i = clockVictim();
+        if (i < 0)
+            break;
+        frameTake(i, as, v, pte);
+        frameReading(i, slot + n);
+    }
+
+    SEQ_NEXT[k] = vaddr + n * PAGESIZE;
+    return n;
+}
+
+static int pageIn(pcb_t *p, aspace_t *as, unsigned int vaddr,
+                  unsigned int pte, int write) {
+    int k = pcbIndex(p);
+    int cyl, head, sect;
+    int slot, n, i;
+
+    i = clockVictim();
+    if (i < 0) {
+        i = frameBusy();
+        return i < 0 ? -1 : frameWait(i, p);
+    }
+
+    frameTake(i, as, vaddr, pte);
+    if (pte & SW_ZERO) {
+        frameZero(i);
+        FRAME[i].f_state = FS_USED;
+        FRAME[i].f_dirty = 1;
+        frameMap(i, write);
+        ++stats.sw_zero;
+        return 1;
+    }
+
+    slot = pte >> 12;
+    frameReading(i, slot);
+    n = readAhead(p, as, vaddr, slot);
+
+    FAULT_TOD[k] = readTOD();
+    FAULT_FRAME[k] = i;
+    FAULT_WRITE[k] = write;
+    slotPlace(slot, &cyl, &head, &sect);
+    diskSubmit(area.sa_dq, p, cyl, head, sect, n, 0, NULL);
+    ++stats.sw_major;
+    stats.sw_pageIns += n;
+    stats.sw_readAhead += n - 1;
+    return 0;
+}
+
+
+int swapFault(pcb_t *p, unsigned int vaddr, int write) {
+    aspace_t *as;
+    unsigned int pte;
+    int i;
+
+    if (p == NULL)
+        return -1;
+
+    as = getPAs(p);
+    vaddr &= AS_VPN_MASK;
+    pte = asEntryLo(as, vaddr);
+    if (write && !(pte & SW_WRITE))
+        return -1;
+
+    /* A first write, or a fault that was handled meanwhile. */
+    if (pte & AS_VALID) {
+        if (write && !(pte & AS_DIRTY)) {
+            pageRef(pte & AS_PFN_MASK);
+            asSetPte(as, vaddr, pte | AS_DIRTY);
+        }
+        return 1;
+    }
+
+    if (pte & SW_RESIDENT) {
+        i = pte >> 12;
+        if (FRAME[i].f_state != FS_USED)
+            return frameWait(i, p);
+        frameMap(i, write);
+        ++stats.sw_minor;
+        return 1;
+    }
+
+    if (pte & (SW_SWAPPED | SW_ZERO))
+        return pageIn(p, as, vaddr, pte, write);
+    return -1;
+}
+
+
+unsigned int swapSector(ioreq_t *r, int i, int *write) {
+    int slot;
+    sframe_t *f;
+
+    if (r == NULL)
+        return 0;
+    slot = (r->r_cyl * area.sa_heads + r->r_head) * area.sa_sects +
+        r->r_sect - slotSector(0) + i;
+    if (slot < 0 || slot >= area.sa_slots || SLOT_FRAME[slot] < 0)
+        return 0;
+
+    f = &FRAME[SLOT_FRAME[slot]];
+    if (write != NULL)
+        *write = f->f_state == FS_PAGEOUT;
+    return f->f_addr;
+}
+
+
+/* The frames of the transfer become usable, holding a clean page.
+ * Frames whose space was released meanwhile are freed instead.  The
+ * processes that read are given their page at once. */
+int swapDiskDone(pcbq_t **rq) {
+    ioreq_t *r = area.sa_dq->dq_active;
+    pcbq_t *done = mkEmptyProcQ();
+    sframe_t *f;
+    pcb_t *p;
+    int slot, i, j, k;
+    int n = 0;
+
+    if (r == NULL)
+        return 0;
+
+    slot = (r->r_cyl * area.sa_heads + r->r_head) * area.sa_sects +
+        r->r_sect - slotSector(0);
+    for (j = 0; j < r->r_count; ++j) {
+        if (slot + j < 0 || slot + j >= area.sa_slots)
+            continue;
+        i = SLOT_FRAME[slot + j];
+        SLOT_FRAME[slot + j] = -1;
+        if (i < 0)
+            continue;
+        f = &FRAME[i];
+        if (f->f_state == FS_PAGEOUT) {
+            f->f_dirty = 0;
+            ++stats.sw_pageOuts;
+        }
+        f->f_state = FS_USED;
+        if (f->f_as == NULL) {
+            slotFree(f->f_slot);
+            f->f_slot = -1;
+            f->f_state = FS_FREE;
+        }
+        n += frameWake(i, rq);
+    }
+
+    diskDone(area.sa_dq, &done);
+    while ((p = removeProcQ(&done)) != NULL) {
+        if (p == pager) {
+            pagerBusy = 0;
+            continue;
+        }
+        k = pcbIndex(p);
+        if (FAULT_FRAME[k] >= 0 && FRAME[FAULT_FRAME[k]].f_as != NULL)
+            frameMap(FAULT_FRAME[k], FAULT_WRITE[k]);
+        FAULT_FRAME[k] = -1;
+        latency(p);
+        insertProcQ(rq, p);
+        ++n;
+    }
+
+    batchFlush();
+    return n;
+}
+
+
+/* Frames in transit are only orphaned: swapDiskDone frees them. */
+void swapRelease(aspace_t *as) {
+    sframe_t *f;
+    int i;
+
+    if (as == NULL)
+        return;
+
+    for (i = 0; i < nFrames; ++i) {
+        f = &FRAME[i];
+        if (f->f_as != as)
+            continue;
+        asSetPte(as, f->f_vaddr, 0);
+        f->f_as = NULL;
+        if (f->f_state == FS_USED) {
+            slotFree(f->f_slot);
+            f->f_slot = -1;
+            f->f_state = FS_FREE;
+        }
+    }
+
+    for (i = 0; i < AS_NPTE; ++i) {
+        if (as->as_pte[i] & AS_VALID)
+            continue;
+        if (as->as_pte[i] & (SW_ZERO | SW_SWAPPED))
+            slotFree(as->as_pte[i] >> 12);
+        as->as_pte[i] = 0;
+    }
+}
+
+
+void swapStats(swapstats_t *out) {
+    if (out != NULL)
+        *out = stats;
+}
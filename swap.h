@@ -0,0 +1,125 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* swap.h --- Demand paging to a disk.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "proc.h"
+#include "as.h"
+#include "diskq.h"
+#include "hist.h"
+
+/* Paged pages of user address spaces live in a swap area of a disk, and
+   are brought into a fixed set of frames when they fault.  When no frame
+   is free, the CLOCK hand picks one: a page used since the hand last
+   passed (its entry was valid) is unmapped and given a second chance; a
+   dirty one is queued for write-back; a clean one is evicted.  Each page
+   has its own slot, a sector of the swap area, so that pages reserved
+   in order are in order on the disk.  Dirty pages are written back in
+   batches, sorted by slot, by transfers the pager process submits: one
+   per run of consecutive slots; a fault on a page of a batch that is not
+   full yet submits it when the pager is idle.  A fault right after the pages read last
+   makes the transfer read ahead the next pages, when they follow on the
+   disk.
+
+   A process that faults on a page being transferred, or when every
+   frame is, blocks on the semaphore of the frame.  The process whose
+   fault starts a read waits for the transfer on the disk.
+
+   The TLB exception handler (see asSetFault) calls swapFault, and the
+   interrupt handler of the disk calls swapDiskDone instead of diskDone.
+   Transfers are started with diskStart, and swapSector tells the driver
+   which frame each sector goes to or comes from.  Each sector holds a
+   page.  Paged pages are AS_PAGED: asFork refuses a space that has
+   some.
+
+   On a multiprocessor, a processor running the space of a page that is
+   unmapped keeps its TLB entry until it activates a space (see
+   asSetPte): the kernel must make it call asActivate before the frame
+   of an evicted page is reused.  */
+
+/* Number of frames and swap slots at most.  */
+#ifndef SWAP_MAXFRAMES
+#define SWAP_MAXFRAMES 64
+#endif
+#ifndef SWAP_MAXSLOTS
+#define SWAP_MAXSLOTS 1024
+#endif
+
+/* Most dirty pages written back in one transfer.  */
+#define SWAP_BATCH 8
+
+/* Default read-ahead window, in pages, the faulting one included.  */
+#define SWAP_READAHEAD 8
+
+/* The swap area is `sa_slots' sectors from the start of the cylinder
+   `sa_cyl' of the disk of `sa_dq'.  */
+typedef struct swaparea {
+    diskq_t *sa_dq;
+    int      sa_heads;		/* Geometry of the disk.  */
+    int      sa_sects;
+    int      sa_cyl;
+    int      sa_slots;		/* At most SWAP_MAXSLOTS.  */
+} swaparea_t;
+
+typedef struct swapstats {
+    unsigned int sw_major;	/* Faults that read from the disk.  */
+    unsigned int sw_minor;	/* Faults on a page still in a frame.  */
+    unsigned int sw_zero;	/* Pages filled with zeros.  */
+    unsigned int sw_pageIns;	/* Pages read.  */
+    unsigned int sw_readAhead;	/* Pages read before their fault.  */
+    unsigned int sw_pageOuts;	/* Pages written back.  */
+    unsigned int sw_batches;	/* Write-back transfers.  */
+    unsigned int sw_frameWaits;	/* Faults blocked on a frame.  */
+    /* TOD ticks from a fault that blocks to the wakeup.  */
+    unsigned int sw_latency[HIST_BUCKETS];
+    unsigned int sw_maxLatency;
+} swapstats_t;
+
+/* Page on the swap area `area' with `nframes' frames taken from allocPage,
+   at most SWAP_MAXFRAMES.  The process `pager', which must be on no queue,
+   submits the write-backs.  Call it after initAS.  Return the number of
+   frames obtained.  */
+int initSwap (swaparea_t *area, pcb_t *pager, int nframes);
+
+/* Set the largest read-ahead window to `pages'; 1 turns read-ahead off.  */
+void swapSetReadAhead (int pages);
+
+/* Make the page of `vaddr' in `as' a paged page, filled with zeros on its
+   first fault, and give it the next free slot.  Return FALSE if `vaddr'
+   is not in a user address space or the swap area is full.  */
+int swapReserve (aspace_t *as, unsigned int vaddr, int writable);
+
+/* Handle a fault of the process `p' on the page of `vaddr', for a write
+   if `write' is TRUE.  Return 1 if the page is mapped and `p' can retry
+   the access, 0 if `p' is blocked until it can, and -1 if the access is
+   not allowed.  */
+int swapFault (pcb_t *p, unsigned int vaddr, int write);
+
+/* Return the address of the frame the sector `i' of the transfer `r'
+   goes to or comes from, and set `*write' to TRUE if it is written to
+   the disk.  Return 0 if `r' is not a swap transfer.  */
+unsigned int swapSector (ioreq_t *r, int i, int *write);
+
+/* Complete the transfer in progress on the swap disk, as diskDone: the
+   processes waiting for it or for its frames are inserted at the tail of
+   `rq', and the next write-back is submitted.  Return the number of
+   processes woken.  */
+int swapDiskDone (pcbq_t **rq);
+
+/* Give back the frames and slots of `as', whose process ends.  Call it
+   before asFree.  freePcb does both for the processes it frees.  */
+void swapRelease (aspace_t *as);
+
+/* Fill `out' with the paging statistics.  */
+void swapStats (swapstats_t *out);
+
+#endif
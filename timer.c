@@ -0,0 +1,293 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* timer.c --- Tickless interval timer.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#include "timer.h"
+#include "atomic.h"
+#include "tod.h"
+
+#ifdef HOST
+#define setInterval(ticks) ((void) (ticks))
+#else
+#include "umps/arch.h"
+#define setInterval(ticks) \
+    (*((volatile unsigned int *) BUS_REG_TIMER) = (ticks))
+#endif
+
+/* What the timer is set to when it is off: the longest interval. */
+#define TIMER_OFF 0xFFFFFFFF
+
+
+/* Binary min-heap of the processes with a pending timeout, ordered by
+ * their time, as the EDF queue.  The time and heap index of each process
+ * are kept by pcbIndex. */
+static pcb_t *TIMER_HEAP[MAXPROC];
+static unsigned int TIMER_WHEN[MAXPROC];
+static int TIMER_IDX[MAXPROC];
+static int heapSize;
+
+/* End of the quantum of each processor, whether it has one, and whether
+ * it ended.  Any TOD, 0 included, is a valid time. */
+static unsigned int CPU_QUANTUM[MAXCPU];
+static int CPU_QUANTUM_SET[MAXCPU];
+static int CPU_QUANTUM_OVER[MAXCPU];
+
+static unsigned int slackTicks;
+static unsigned int nextTOD;	/* What the timer is set to, if on. */
+static int timerOn;
+static unsigned int startTOD;
+static int timerLock;
+
+static timerstats_t stats;
+
+
+#define before(a, b) ((int) ((a) - (b)) < 0)
+#define when(i)      (TIMER_WHEN[pcbIndex(TIMER_HEAP[i])])
+
+
+/* A freed process has no timeout left. */
+static void timerForget(pcb_t *p) {
+    timerCancel(p);
+}
+
+
+void initTimer(unsigned int slack) {
+    int i;
+
+    addFreeHook(timerForget);
+    heapSize = 0;
+    for (i = 0; i < MAXPROC; ++i)
+        TIMER_IDX[i] = -1;
+    for (i = 0; i < MAXCPU; ++i) {
+        CPU_QUANTUM_SET[i] = 0;
+        CPU_QUANTUM_OVER[i] = 0;
+    }
+    slackTicks = slack;
+    nextTOD = 0;
+    timerOn = 0;
+    startTOD = readTOD();
+    timerLock = 0;
+    stats.ts_interrupts = 0;
+    stats.ts_expired = 0;
+    stats.ts_coalesced = 0;
+    stats.ts_off = 0;
+    setInterval(TIMER_OFF);
+}
+
+
+void timerSetSlack(unsigned int slack) {
+    slackTicks = slack;
+}
+
+
+static void heapSet(int i, pcb_t *p) {
+    TIMER_HEAP[i] = p;
+    TIMER_IDX[pcbIndex(p)] = i;
+}
+
+
+static void siftUp(int i) {
+    pcb_t *p = TIMER_HEAP[i];
+    unsigned int w = TIMER_WHEN[pcbIndex(p)];
+
+    while (i > 0 && before(w, when((i - 1) / 2))) {
+        heapSet(i, TIMER_HEAP[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    heapSet(i, p);
+}
+
+
+static void siftDown(int i) {
+    pcb_t *p = TIMER_HEAP[i];
+    unsigned int w = TIMER_WHEN[pcbIndex(p)];
+    int c;
+
+    while ((c = 2 * i + 1) < heapSize) {
+        if (c + 1 < heapSize && before(when(c + 1), when(c)))
+            ++c;
+        if (!before(when(c), w))
+            break;
+        heapSet(i, TIMER_HEAP[c]);
+        i = c;
+    }
+    heapSet(i, p);
+}
+
+
+/* Take the process at index i out of the heap. */
+static void heapRemove(int i) {
+    pcb_t *p = TIMER_HEAP[i];
+
+    TIMER_IDX[pcbIndex(p)] = -1;
+    if (i == --heapSize)
+        return;
+    heapSet(i, TIMER_HEAP[heapSize]);
+    siftDown(i);
+    siftUp(TIMER_IDX[pcbIndex(TIMER_HEAP[i])]);
+}
+
+
+/* Set the timer for the earliest of the first timeout, given its slack,
+ * and the quantum ends.  The timer is written only when that changes,
+ * unless force is TRUE, e.g. to acknowledge an interrupt.  The quanta of
+ * all the processors share the one interval timer of the bus. */
+static void program(int force) {
+    unsigned int next = 0;
+    unsigned int now;
+    int on = 0;
+    int i;
+
+    if (heapSize > 0) {
+        next = when(0) + slackTicks;
+        on = 1;
+    }
+    for (i = 0; i < MAXCPU; ++i)
+        if (CPU_QUANTUM_SET[i] && (!on || before(CPU_QUANTUM[i], next))) {
+            next = CPU_QUANTUM[i];
+            on = 1;
+        }
+
+    if (!force && on == timerOn && (!on || next == nextTOD))
+        return;
+    timerOn = on;
+    nextTOD = next;
+    if (!on) {
+        ++stats.ts_off;
+        setInterval(TIMER_OFF);
+        return;
+    }
+    now = readTOD();
+    setInterval(before(now, next) ? next - now : 0);
+}
+
+
+void timerAdd(pcb_t *p, unsigned int when) {
+    int i;
+
+    if (p == NULL)
+        return;
+
+    spinLock(&timerLock);
+    i = pcbIndex(p);
+    TIMER_WHEN[i] = when;
+    if (TIMER_IDX[i] < 0) {
+        heapSet(heapSize++, p);
+        siftUp(heapSize - 1);
+    }
+    else {
+        siftDown(TIMER_IDX[i]);
+        siftUp(TIMER_IDX[i]);
+    }
+    program(0);
+    spinUnlock(&timerLock);
+}
+
+
+/* The heap is checked to hold p, so that a process freed before
+ * initTimer, whose index is still 0, is not taken for the first. */
+pcb_t *timerCancel(pcb_t *p) {
+    int i;
+
+    if (p == NULL)
+        return NULL;
+
+    spinLock(&timerLock);
+    i = TIMER_IDX[pcbIndex(p)];
+    if (i < 0 || i >= heapSize || TIMER_HEAP[i] != p) {
+        spinUnlock(&timerLock);
+        return NULL;
+    }
+    heapRemove(i);
+    program(0);
+    spinUnlock(&timerLock);
+    return p;
+}
+
+
+void timerQuantum(unsigned int end) {
+    spinLock(&timerLock);
+    CPU_QUANTUM[cpuId()] = end;
+    CPU_QUANTUM_SET[cpuId()] = 1;
+    CPU_QUANTUM_OVER[cpuId()] = 0;
+    program(0);
+    spinUnlock(&timerLock);
+}
+
+
+void timerQuantumOff(void) {
+    spinLock(&timerLock);
+    CPU_QUANTUM_SET[cpuId()] = 0;
+    CPU_QUANTUM_OVER[cpuId()] = 0;
+    program(0);
+    spinUnlock(&timerLock);
+}
+
+
+/* Every timeout due by now expires, not only the one the timer was set
+ * for: those are the ones coalesced. */
+int timerInterrupt(pcbq_t **rq) {
+    unsigned int now = readTOD();
+    int n = 0;
+    int i;
+
+    spinLock(&timerLock);
+    ++stats.ts_interrupts;
+    while (heapSize > 0 && !before(now, when(0))) {
+        insertProcQ(rq, TIMER_HEAP[0]);
+        heapRemove(0);
+        ++n;
+    }
+    for (i = 0; i < MAXCPU; ++i)
+        if (CPU_QUANTUM_SET[i] && !before(now, CPU_QUANTUM[i])) {
+            CPU_QUANTUM_SET[i] = 0;
+            CPU_QUANTUM_OVER[i] = 1;
+        }
+
+    stats.ts_expired += n;
+    if (n > 1)
+        stats.ts_coalesced += n - 1;
+    program(1);
+    spinUnlock(&timerLock);
+    return n;
+}
+
+
+int timerQuantumOver(void) {
+    int over = CPU_QUANTUM_OVER[cpuId()];
+
+    CPU_QUANTUM_OVER[cpuId()] = 0;
+    return over;
+}
+
+
+int timerNext(unsigned int *when) {
+    if (timerOn && when != NULL)
+        *when = nextTOD;
+    return timerOn;
+}
+
+
+/* A periodic timer would have interrupted once every TIMER_TICK. */
+void timerStats(timerstats_t *out) {
+    unsigned int periodic;
+    unsigned int ms;
+
+    if (out == NULL)
+        return;
+
+    stats.ts_elapsed = (readTOD() - startTOD) / todScale();
+    periodic = stats.ts_elapsed / TIMER_TICK;
+    stats.ts_avoided = periodic > stats.ts_interrupts ?
+        periodic - stats.ts_interrupts : 0;
+    ms = stats.ts_elapsed / 1000;
+    stats.ts_avoidedPerSec = ms > 0 ? stats.ts_avoided * 1000 / ms : 0;
+    *out = stats;
+}
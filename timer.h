@@ -0,0 +1,87 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* timer.h --- Tickless interval timer.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "proc.h"
+
+/* The interval timer is not programmed to interrupt every TIMER_TICK,
+   but only for the next event: the earliest timeout of a process, or the
+   end of the quantum of a processor.  When there is none, e.g. when every
+   process is blocked on a semaphore, it is left off.
+
+   A timeout may expire up to the slack after its time, so that the
+   timeouts that fall within the slack of the earliest one expire on the
+   same interrupt.  Quantum ends have no slack.
+
+   The processors share the one interval timer of the bus: it is set for
+   the earliest quantum end of all, and each interrupt ends every quantum
+   due, whichever processor takes it.  */
+
+/* Period of a periodic timer, in microseconds, with which the interrupts
+   taken are compared.  */
+#ifndef TIMER_TICK
+#define TIMER_TICK 5000
+#endif
+
+typedef struct timerstats {
+    unsigned int ts_interrupts;	/* Timer interrupts taken.  */
+    unsigned int ts_expired;	/* Timeouts expired.  */
+    unsigned int ts_coalesced;	/* Timeouts expired with another.  */
+    unsigned int ts_off;	/* Times the timer was left off.  */
+    unsigned int ts_elapsed;	/* Microseconds since initTimer.  */
+    /* Interrupts a periodic timer would have taken on top of
+       ts_interrupts: in all, and per second.  */
+    unsigned int ts_avoided;
+    unsigned int ts_avoidedPerSec;
+} timerstats_t;
+
+/* Initialize the module with the slack `slack', in TOD ticks: no timeout
+   is pending and no processor has a quantum.  Call it after initProc.  */
+void initTimer (unsigned int slack);
+
+/* Change the slack to `slack' TOD ticks.  */
+void timerSetSlack (unsigned int slack);
+
+/* Make the process `p' wake up at the TOD `when', replacing its pending
+   timeout if it has one.  */
+void timerAdd (pcb_t *p, unsigned int when);
+
+/* Cancel the pending timeout of `p'.  Return NULL if it had none, and `p'
+   otherwise.  freePcb does it for the processes it frees (see
+   addFreeHook).  */
+pcb_t *timerCancel (pcb_t *p);
+
+/* Make the quantum of the current processor end at the TOD `end'.  */
+void timerQuantum (unsigned int end);
+
+/* Give the current processor no quantum, e.g. when it goes idle.  */
+void timerQuantumOff (void);
+
+/* Handle an interrupt of the interval timer: insert the processes whose
+   timeout has expired at the tail of the process queue `rq', and program
+   the timer for the next event.  Return the number of processes
+   inserted.  */
+int timerInterrupt (pcbq_t **rq);
+
+/* Return TRUE, once, if the quantum of the current processor has ended.  */
+int timerQuantumOver (void);
+
+/* Return TRUE if the interval timer is programmed, and store the TOD it
+   is programmed for in `*when' if `when' is not NULL; return FALSE if it
+   is off.  */
+int timerNext (unsigned int *when);
+
+/* Fill `out' with the timer statistics.  */
+void timerStats (timerstats_t *out);
+
+#endif
@@ -0,0 +1,29 @@
+/* Vincent Foley-Bourgon (FOLV08078309)
+ * Eric Thivierge        (THIE09016601) */
+
+/* tod.h --- Reading the time of day clock.
+
+This file is part of Kaya OS.
+Kaya OS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.  See <http://www.gnu.org/licenses/>.  */
+
+#ifndef TOD_H
+#define TOD_H
+
+/* Return the low word of the TOD clock, in ticks.  The difference of two
+   readings is correct across a wrap-around as long as it is taken as an
+   unsigned int.  todScale returns the number of ticks per microsecond.  */
+#ifdef HOST
+/* Built as a Linux program (see host/): ticks are microseconds.  */
+unsigned int hostTOD (void);
+#define readTOD() hostTOD()
+#define todScale() 1
+#else
+#include "umps/arch.h"
+#define readTOD() (*((volatile unsigned int *) BUS_REG_TOD_LO))
+#define todScale() (*((volatile unsigned int *) BUS_REG_TIME_SCALE))
+#endif
+
+#endif
@@ -7,6 +7,20 @@
 
 #include "proc.h"
 #include "sema.h"
+#include "lock.h"
+#include "chan.h"
+#include "edf.h"
+#include "diskq.h"
+#include "page.h"
+#include "as.h"
+#include "ring.h"
+#include "timer.h"
+#include "lat.h"
+#include "rcu.h"
+#include "swap.h"
+#include "tod.h"
+#include "atomic.h"
+#include "check.h"
 
 #define MAXPROCESS 20
 
@@ -44,20 +58,25 @@ int test_initProc(void) {
     pcb_t *p1, *p2;
 
     initProc();
+    success &= getFreeProcessCount() == MAXPROCESS;
 
-    for (i = 0; i < MAXPROCESS-1; ++i) {
-        p1 = getFreeProcess(i);
-        p2 = getFreeProcess(i+1);
-
-        /* Make sure p1 points to p2. */
-        success &= getPNext(p1) == p2;
-    }
-
-    i = MAXPROCESS-1;
-    p1 = getFreeProcess(i);
-    success &= getPNext(p1) == NULL;
+    /* Unused pcb's are handed out in pool order. */
+    for (i = 0; i < MAXPROCESS; ++i)
+        success &= allocPcb() == getFreeProcess(i);
+    success &= allocPcb() == NULL;
 
+    /* Freed pcb's are reused before anything else. */
+    p1 = getFreeProcess(3);
+    p2 = getFreeProcess(7);
+    freePcb(p1);
+    freePcb(p2);
+    success &= allocPcb() == p2;
+    success &= allocPcb() == p1;
 
+    /* A new initProc makes the whole pool available again. */
+    initProc();
+    success &= getFreeProcessCount() == MAXPROCESS;
+    success &= allocPcb() == getFreeProcess(0);
 
     return success;
 }
@@ -120,6 +139,154 @@ int test_allocFreeNull(void) {
 }
 
 
+int test_procState(void) {
+    int success = 1;
+    pcb_t *p1, *p2, *p3;
+    pcb_t *out[MAXPROCESS];
+    semd_t *s1;
+#ifdef VALIDATE
+    int n;
+#endif
+
+    initASL();
+    initProc();
+
+    p1 = allocPcb();
+    p2 = allocPcb();
+    p3 = allocPcb();
+
+    success &= countProcState(PS_FREE) == MAXPROCESS - 3;
+    success &= countProcState(PS_READY) == 3;
+    success &= getPState(p1) == PS_READY;
+
+    setPState(p1, PS_RUNNING);
+    setPState(p2, PS_FREE);
+    success &= getPState(p2) == PS_READY;
+
+    initSemD(&s1, 0);
+    insertBlocked(s1, p2);
+    insertBlocked(s1, p3);
+    success &= countProcState(PS_BLOCKED) == 2;
+    success &= countProcState(PS_READY) == 0;
+    success &= listProcState(PS_RUNNING, out, MAXPROCESS) == 1;
+    success &= out[0] == p1;
+    success &= listProcState(PS_BLOCKED, out, 1) == 1;
+
+    removeBlocked(s1);
+    success &= getPState(p2) == PS_READY;
+    outBlocked(p3);
+    success &= countProcState(PS_BLOCKED) == 0;
+
+    /* A double free is ignored, and reported in validation mode. */
+#ifdef VALIDATE
+    checkSetFatal(0);
+    n = checkFailures();
+#endif
+    freePcb(p3);
+    freePcb(p3);
+#ifdef VALIDATE
+    success &= checkFailures() == n + 1;
+    checkSetFatal(1);
+#endif
+    success &= countProcState(PS_FREE) == MAXPROCESS - 2;
+    success &= listProcState(PS_FREE, out, MAXPROCESS) == MAXPROCESS - 2;
+    success &= out[0] == p3;
+
+    return success;
+}
+
+
+int test_acct(void) {
+    int success = 1;
+    pcb_t *p1, *p2, *p3;
+    pacct_t self, children;
+    semd_t *s;
+    pcbq_t *rq;
+
+    initASL();
+    initProc();
+
+    rq = mkEmptyProcQ();
+    p1 = allocPcb();
+    p2 = allocPcb();
+    p3 = allocPcb();
+    insertChild(p1, p2);
+    insertChild(p2, p3);
+    initSemD(&s, 0);
+
+    getPAcct(p2, &self, &children);
+    success &= self.pa_switches == 0 && self.pa_cpu == 0;
+    success &= children.pa_switches == 0;
+
+    /* Dispatch and preempt p2 twice, then have it block and wake up. */
+    setPState(p2, PS_RUNNING);
+    setPState(p2, PS_READY);
+    setPState(p2, PS_RUNNING);
+    setPState(p2, PS_RUNNING);
+    passerenN(s, p2, 1);
+    success &= getPState(p2) == PS_BLOCKED;
+    verhogenN(s, 1, &rq);
+    getPAcct(p2, &self, NULL);
+    success &= self.pa_switches == 2;
+    success &= getPStateTOD(p2) - getPStateTOD(p1) >=
+        self.pa_cpu + self.pa_wait + self.pa_blocked;
+    setPState(p3, PS_RUNNING);
+
+    /* p3 is accounted to p2, then both to p1. */
+    outChild(p2);
+    getPAcct(p2, NULL, &children);
+    success &= children.pa_switches == 1;
+    getPAcct(p1, &self, &children);
+    success &= self.pa_switches == 0;
+    success &= children.pa_switches == 3;
+
+    /* Through removeChild as well. */
+    insertChild(p1, p2);
+    removeChild(p1);
+    getPAcct(p1, NULL, &children);
+    success &= children.pa_switches == 6;
+
+    return success;
+}
+
+
+/* Free hooks for test_freeHook: each records its turn. */
+static pcb_t *hooked;
+static int hookTurn, hookA, hookB;
+
+static void freeHookA(pcb_t *p) {
+    hooked = p;
+    hookA = ++hookTurn;
+}
+
+static void freeHookB(pcb_t *p) {
+    hookB = ++hookTurn;
+}
+
+int test_freeHook(void) {
+    int success = 1;
+    pcb_t *p;
+
+    initProc();
+    hookTurn = hookA = hookB = 0;
+    p = allocPcb();
+
+    /* The last hook added runs first; adding one again changes nothing. */
+    success &= addFreeHook(freeHookA);
+    success &= addFreeHook(freeHookB);
+    success &= addFreeHook(freeHookA);
+    success &= !addFreeHook(NULL);
+    freePcb(p);
+    success &= hooked == p && hookB == 1 && hookA == 2;
+
+    /* initProc removes them. */
+    initProc();
+    freePcb(allocPcb());
+    success &= hookTurn == 2;
+
+    return success;
+}
+
 
 int test_EmptyProcQ(void) {
     int success = 1;
@@ -246,6 +413,79 @@ int test_headProcQ(void) {
 }
 
 
+int test_moveProcQ(void) {
+    int success = 1;
+    pcb_t *p1, *p2, *p3, *p4;
+    pcbq_t *q, *r;
+
+    initProc();
+    q = mkEmptyProcQ();
+    r = mkEmptyProcQ();
+    p1 = allocPcb();
+    p2 = allocPcb();
+    p3 = allocPcb();
+    p4 = allocPcb();
+
+    success &= moveProcQ(&q, &r) == NULL;
+    success &= moveProcQN(&q, &r, 3) == 0;
+
+    insertProcQ(&q, p1);
+    insertProcQ(&q, p2);
+    insertProcQ(&q, p3);
+    insertProcQ(&r, p4);
+
+    success &= moveProcQ(&q, &r) == p1;
+    success &= headProcQ(q) == p2;
+    success &= headProcQ(r) == p4;
+
+    /* Asking for more than there is moves the whole queue. */
+    success &= moveProcQN(&q, &r, 5) == 2;
+    success &= emptyProcQ(q);
+    success &= removeProcQ(&r) == p4;
+    success &= removeProcQ(&r) == p1;
+    success &= removeProcQ(&r) == p2;
+    success &= removeProcQ(&r) == p3;
+    success &= emptyProcQ(r);
+
+    return success;
+}
+
+
+
+int test_spliceProcQ(void) {
+    int success = 1;
+    pcb_t *p1, *p2, *p3, *p4;
+    pcbq_t *q, *r;
+
+    initProc();
+    q = mkEmptyProcQ();
+    r = mkEmptyProcQ();
+    p1 = allocPcb();
+    p2 = allocPcb();
+    p3 = allocPcb();
+    p4 = allocPcb();
+
+    spliceProcQ(&q, &r);
+    success &= emptyProcQ(r);
+
+    insertProcQ(&q, p1);
+    spliceProcQ(&q, &r);
+    success &= emptyProcQ(q);
+    success &= headProcQ(r) == p1;
+
+    insertProcQ(&q, p2);
+    insertProcQ(&q, p3);
+    insertProcQ(&r, p4);
+    spliceProcQ(&q, &r);
+    success &= emptyProcQ(q);
+    success &= removeProcQ(&r) == p1;
+    success &= removeProcQ(&r) == p4;
+    success &= removeProcQ(&r) == p2;
+    success &= removeProcQ(&r) == p3;
+    success &= emptyProcQ(r);
+
+    return success;
+}
 
 int test_emptyChild(void) {
     int success = 1;
@@ -335,23 +575,76 @@ int test_outChild(void) {
 }
 
 
+int test_rcu(void) {
+    int success = 1;
+    pcb_t *p1, *p2, *p3, *p4;
+    rcustats_t st;
+
+    initProc();
+    initRCU(1);
+    p1 = allocPcb();
+    p2 = allocPcb();
+    p3 = allocPcb();
+    p4 = allocPcb();
+
+    insertChild(p1, p2);
+    insertChild(p1, p3);
+    insertChild(p3, p4);
+    success &= headChild(p1) == p3 && nextChild(p3) == p2;
+    success &= nextChild(p2) == NULL && headChild(p2) == NULL;
+
+    /* A reader still on p3 goes on to p2. */
+    success &= outChild(p3) == p3;
+    success &= headChild(p1) == p2;
+    success &= nextChild(p3) == p2;
+
+    /* p3 and p4 are freed once this processor has passed a quiescent
+       state. */
+    rcuFreePcb(p3);
+    rcuFreePcb(p4);
+    success &= rcuReclaim() == 0;
+    success &= getPState(p3) != PS_FREE && getPState(p4) != PS_FREE;
+    rcuQuiescent();
+    success &= rcuReclaim() == 1;
+    success &= getPState(p3) == PS_FREE && getPState(p4) != PS_FREE;
+    rcuQuiescent();
+    success &= rcuReclaim() == 1;
+    success &= getPState(p4) == PS_FREE;
+
+    /* Grace periods do not wait for offline processors. */
+    success &= removeChild(p1) == p2;
+    rcuOffline();
+    rcuFreePcb(p2);
+    success &= rcuReclaim() == 1;
+    rcuOnline();
+    success &= getPState(p2) == PS_FREE;
+
+    rcuStats(&st);
+    success &= st.rs_deferred == 3 && st.rs_freed == 3;
+    success &= st.rs_graces == 3 && st.rs_pending == 0;
+
+    return success;
+}
+
+
 
 int test_initASL(void) {
     int i;
     int success = 1;
-    semd_t *s1, *s2;
+    semd_t *s1;
 
     initASL();
 
-    for (i = 0; i < MAXPROCESS-1; ++i) {
-        s1 = getSema(i);
-        s2 = getSema(i+1);
+    success &= getSemdFree() == getSema(0);
+    success &= getASL() == NULL;
 
-        success &= getSNext(s1) == s2;
+    for (i = 0; i < MAXPROCESS; ++i) {
+        success &= initSemD(&s1, i);
+        success &= s1 == getSema(i);
     }
-    s1 = getSema(MAXPROCESS - 1);
-    success &= getSNext(s1) == NULL;
+    success &= getSemdFree() == NULL;
 
+    initASL();
     success &= getSemdFree() == getSema(0);
 
     return success;
@@ -385,6 +678,47 @@ int test_initSemDExhaustion(void) {
 }
 
 
+int test_initSemDEmbed(void) {
+    int success = 1;
+    static semd_t sems[3 * MAXPROCESS];
+    semd_t *s;
+    pcb_t *p1, *p2;
+    pcbq_t *rq = mkEmptyProcQ();
+    int i;
+
+    initASL();
+    initProc();
+    p1 = allocPcb();
+    p2 = allocPcb();
+
+    /* Embedded semaphores do not come from the pool. */
+    for (i = 0; i < 3 * MAXPROCESS; ++i)
+        initSemDEmbed(&sems[i], i);
+    for (i = 0; i < MAXPROCESS; ++i)
+        success &= initSemD(&s, i);
+    success &= getSValue(&sems[3 * MAXPROCESS - 1]) == 3 * MAXPROCESS - 1;
+
+    /* They are on the ASL only while processes wait on them. */
+    success &= getASL() == NULL;
+    success &= !passerenN(&sems[0], p1, 1);
+    insertBlocked(&sems[2 * MAXPROCESS], p2);
+    success &= getASL() == &sems[0];
+    success &= getSNext(&sems[0]) == &sems[2 * MAXPROCESS];
+    success &= verhogenN(&sems[0], 1, &rq) == 1;
+    success &= removeProcQ(&rq) == p1;
+    success &= outBlocked(p2) == p2;
+    success &= getASL() == NULL;
+
+    /* Freeing only marks them free. */
+    success &= freeSemD(&sems[0]);
+    success &= passerenN(&sems[0], p1, 0) == -1;
+    success &= getPState(p1) == PS_READY;
+    success &= getSemdFree() == NULL;
+
+    return success;
+}
+
+
 int test_insertBlocked(void) {
     int success = 1;
     semd_t *s1, *s2, *s3;
@@ -536,28 +870,1244 @@ int test_headBlocked(void) {
     return success;
 }
 
+int test_moveBlocked(void) {
+    int success = 1;
+    semd_t *s1;
+    pcb_t *p1, *p2, *p3;
+    pcbq_t *rq;
+
+    initASL();
+    initProc();
+
+    initSemD(&s1, 0);
+    rq = mkEmptyProcQ();
+    p1 = allocPcb();
+    p2 = allocPcb();
+    p3 = allocPcb();
+
+    success &= moveBlocked(NULL, &rq) == NULL;
+    success &= moveBlocked(s1, &rq) == NULL;
+
+    insertBlocked(s1, p1);
+    insertBlocked(s1, p2);
+    insertBlocked(s1, p3);
+
+    success &= moveBlocked(s1, &rq) == p1;
+    success &= getASL() == s1;
+    success &= moveBlockedN(s1, &rq, 2) == 2;
+    success &= getASL() == NULL;
+    success &= getSemdFree() == s1;
+
+    success &= removeProcQ(&rq) == p1;
+    success &= removeProcQ(&rq) == p2;
+    success &= removeProcQ(&rq) == p3;
+
+    return success;
+}
+
+
+int test_passerenVerhogenN(void) {
+    int success = 1;
+    semd_t *s1;
+    pcb_t *p1, *p2, *p3;
+    pcbq_t *rq;
+
+    initASL();
+    initProc();
+
+    initSemD(&s1, 4);
+    rq = mkEmptyProcQ();
+    p1 = allocPcb();
+    p2 = allocPcb();
+    p3 = allocPcb();
+
+    success &= passerenN(s1, p1, 3);
+    success &= getSValue(s1) == 1;
+    success &= passerenN(s1, p2, -1) == -1;
+    success &= getPState(p2) != PS_BLOCKED && getSValue(s1) == 1;
+    success &= !passerenN(s1, p2, 4);
+    success &= !passerenN(s1, p3, 1);
+    success &= headBlocked(s1) == p2;
+
+    /* Fair: p3 fits but must not overtake p2. */
+    success &= verhogenN(s1, 1, &rq) == 0;
+    success &= verhogenN(s1, 2, &rq) == 1;
+    success &= removeProcQ(&rq) == p2;
+    success &= verhogenN(s1, 1, &rq) == 1;
+    success &= removeProcQ(&rq) == p3;
+    success &= getASL() == NULL;
+
+    /* Greedy: p2 overtakes p1. */
+    initSemD(&s1, 0);
+    setSemFair(s1, 0);
+    passerenN(s1, p1, 5);
+    passerenN(s1, p2, 2);
+    success &= verhogenN(s1, 3, &rq) == 1;
+    success &= removeProcQ(&rq) == p2;
+    success &= getSValue(s1) == 1;
+    success &= headBlocked(s1) == p1;
+
+    return success;
+}
+
+
+int test_semSpin(void) {
+    int success = 1;
+    pcb_t *p1, *p2, *p3;
+    semd_t *s;
+    semspin_t st;
+    pcbq_t *rq;
+
+    initASL();
+    initProc();
+
+    rq = mkEmptyProcQ();
+    p1 = allocPcb();
+    p2 = allocPcb();
+    p3 = allocPcb();
+    initSemDPerm(&s, 1);
+    setSemSpin(s, 1);
+
+    /* Free: taken at once.  Held: the spin gives up after at most twice
+     * the average hold time, and p2 blocks. */
+    success &= semTrySpin(s);
+    success &= !semTrySpin(s);
+    success &= !passerenSpin(s, p2);
+    success &= getPState(p2) == PS_BLOCKED;
+    success &= getSemSpin(s, &st);
+    success &= st.ss_fast == 1 && st.ss_spun == 0 && st.ss_blocked == 1;
+    success &= st.ss_limit == 2 * st.ss_hold;
+
+    /* The V hands the unit over to p2. */
+    success &= verhogenN(s, 1, &rq) == 1;
+    success &= headProcQ(rq) == p2;
+    success &= getSValue(s) == 0;
+    verhogenN(s, 1, &rq);
+    success &= getSValue(s) == 1;
+    removeProcQ(&rq);
+
+    /* A release after the spin gave up is seen by the second step. */
+    success &= passerenSpin(s, p3);
+    success &= getSemSpin(s, &st) && st.ss_spun == 1;
+    verhogenN(s, 1, &rq);
+
+    /* In fair mode, a spinner does not overtake a waiter. */
+    success &= !passerenN(s, p1, 2);
+    success &= !semTrySpin(s);
+    success &= !passerenSpin(s, p3);
+    success &= getSValue(s) == 1;
+    success &= verhogenN(s, 1, &rq) == 1 && removeProcQ(&rq) == p1;
+    success &= verhogenN(s, 1, &rq) == 1 && removeProcQ(&rq) == p3;
+    verhogenN(s, 1, &rq);
+    success &= getSValue(s) == 1;
+
+    /* Without setSemSpin, it is only passerenN. */
+    setSemSpin(s, 0);
+    success &= !semTrySpin(s);
+    success &= passerenSpin(s, p2);
+    success &= getSemSpin(s, &st) && st.ss_fast == 1 && st.ss_spun == 1;
+    verhogenN(s, 1, &rq);
+    freeSemD(s);
+    success &= !getSemSpin(s, &st);
+
+    return success;
+}
+
+
+int test_devSemD(void) {
+    int success = 1;
+    semd_t *s1, *s2;
+    pcb_t *p1, *p2;
+    pcbq_t *rq;
+
+    initASL();
+    initProc();
+
+    rq = mkEmptyProcQ();
+    p1 = allocPcb();
+    p2 = allocPcb();
+
+    success &= getDevSemD(IL_TIMER, 0, 0) == NULL;
+    success &= getDevSemD(IL_DISK, N_DEV_PER_IL, 0) == NULL;
+    success &= getDevSemD(IL_DISK, 0, 1) == NULL;
+
+    s1 = getDevSemD(IL_TERMINAL, 0, 0);
+    s2 = getDevSemD(IL_TERMINAL, 0, 1);
+    success &= s1 != NULL && s2 != NULL && s1 != s2;
+    success &= getSValue(s1) == 0;
+
+    /* Device semaphores never go on the ASL nor back to semdFree. */
+    insertBlocked(s1, p1);
+    insertBlocked(s2, p2);
+    success &= getASL() == NULL;
+    success &= getPSema(p1) == s1;
+    success &= moveBlocked(s1, &rq) == p1;
+    success &= getPSema(p1) == NULL;
+    success &= outBlocked(p2) == p2;
+    success &= getSemdFree() == getSema(0);
+    success &= headBlocked(s2) == NULL;
+
+    insertBlocked(s1, p2);
+    success &= removeBlocked(s1) == p2;
+
+    return success;
+}
+
+
+#ifdef SEMA_PROFILE
+int test_semProf(void) {
+    static semd_t EMBED;
+    int success = 1;
+    semd_t *s1, *s2, *s3;
+    semd_t *top[4];
+    semprof_t prof;
+    pcb_t *p1, *p2, *p3, *p4;
+    pcbq_t *rq = mkEmptyProcQ();
+
+    initASL();
+    initProc();
+
+    s1 = getDevSemD(IL_DISK, 0, 0);
+    s2 = getDevSemD(IL_TAPE, 1, 0);
+    p1 = allocPcb();
+    p2 = allocPcb();
+    p3 = allocPcb();
+    p4 = allocPcb();
+
+    success &= topContended(top, 3) == 0;
+
+    insertBlocked(s1, p1);
+    insertBlocked(s1, p2);
+    insertBlocked(s2, p3);
+    removeBlocked(s1);
+    outBlocked(p2);
+
+    success &= getSemProf(s1, &prof);
+    success &= prof.sp_blocks == 2;
+    success &= prof.sp_acquires == 1;
+    success &= prof.sp_maxDepth == 2;
+    success &= topContended(top, 3) == 2;
+    success &= topContended(top, 1) == 1;
+
+    /* A semaphore of initSemD is given back when its queue drains, but
+       its statistics are still reported. */
+    initSemD(&s3, 0);
+    passerenN(s3, p1, 1);
+    passerenN(s3, p2, 1);
+    success &= verhogenN(s3, 2, &rq) == 2;
+    success &= getSemdFree() == s3;
+    success &= getSemProf(s3, &prof) && prof.sp_blocks == 2;
+    success &= topContended(top, 3) == 3;
+
+    /* So are those of an embedded semaphore, until freeSemD. */
+    initSemDEmbed(&EMBED, 0);
+    insertBlocked(&EMBED, p4);
+    success &= outBlocked(p4) == p4;
+    success &= getSemProf(&EMBED, &prof) && prof.sp_blocks == 1;
+    success &= topContended(top, 4) == 4;
+    initSemDEmbed(&EMBED, 0);
+    success &= topContended(top, 4) == 3;
+    insertBlocked(&EMBED, p4);
+    outBlocked(p4);
+    success &= freeSemD(&EMBED);
+    success &= !getSemProf(&EMBED, &prof);
+    success &= topContended(top, 4) == 3;
+
+    return success;
+}
+#endif
+
+
+#ifdef LATENCY_PROFILE
+static unsigned int histSum(unsigned int *h) {
+    unsigned int n = 0;
+    int i;
+
+    for (i = 0; i < HIST_BUCKETS; ++i)
+        n += h[i];
+    return n;
+}
+
+int test_latProf(void) {
+    int success = 1;
+    semd_t *disk, *tape;
+    pcb_t *p1, *p2;
+    latprof_t lp;
+
+    initProc();
+    initASL();
+    initLat();
+    disk = getDevSemD(IL_DISK, 0, 0);
+    tape = getDevSemD(IL_TAPE, 0, 0);
+    p1 = allocPcb();
+    p2 = allocPcb();
+
+    /* Only a wakeup after an interrupt counts. */
+    insertBlocked(disk, p1);
+    insertBlocked(tape, p2);
+    latInterrupt(IL_DISK, 0, 0);
+    success &= removeBlocked(disk) == p1;
+    success &= removeBlocked(tape) == p2;
+    success &= getLatProf(IL_DISK, 0, &lp) && lp.lp_wakeups == 1;
+    success &= histSum(lp.lp_handler) == 1 && histSum(lp.lp_total) == 0;
+    success &= getLatProf(IL_TAPE, 0, &lp) && lp.lp_wakeups == 0;
+
+    /* The first dispatch after the wakeup ends the measure. */
+    setPState(p1, PS_RUNNING);
+    setPState(p1, PS_READY);
+    setPState(p1, PS_RUNNING);
+    setPState(p2, PS_RUNNING);
+    getLatProf(IL_DISK, 0, &lp);
+    success &= histSum(lp.lp_queue) == 1 && histSum(lp.lp_total) == 1;
+    getLatProf(IL_TAPE, 0, &lp);
+    success &= histSum(lp.lp_total) == 0;
+
+    success &= getLatProf(IL_TERMINAL, 1, &lp);
+    success &= !getLatProf(IL_DISK, 1, &lp);
+
+    return success;
+}
+#endif
+
+
+int test_mutex(void) {
+    int success = 1;
+    mutex_t m;
+    pcb_t *p1, *p2, *p3;
+    pcbq_t *rq;
+
+    initASL();
+    initProc();
+
+    rq = mkEmptyProcQ();
+    p1 = allocPcb();
+    p2 = allocPcb();
+    p3 = allocPcb();
+
+    success &= initMutex(&m);
+    success &= mutexLock(&m, p1);
+    success &= getASL() == NULL;
+    success &= !mutexTryLock(&m, p2);
+    success &= !mutexLock(&m, p2);
+    success &= !mutexLock(&m, p3);
+
+    /* The mutex goes straight to the waiters, in order. */
+    success &= mutexUnlock(&m, &rq) == p2;
+    success &= headProcQ(rq) == p2;
+    success &= mutexUnlock(&m, &rq) == p3;
+    success &= mutexUnlock(&m, &rq) == NULL;
+    success &= getASL() == NULL;
+
+    /* Its semaphore survived the queue draining.  p2 runs again. */
+    removeProcQ(&rq);
+    removeProcQ(&rq);
+    success &= mutexLock(&m, p1);
+    success &= !mutexLock(&m, p2);
+    success &= mutexUnlock(&m, &rq) == p2;
+
+    return success;
+}
+
+
+int test_rwlock(void) {
+    int success = 1;
+    rwlock_t rw;
+    pcb_t *r1, *r2, *r3, *w1, *w2;
+    pcbq_t *rq;
+
+    initASL();
+    initProc();
+
+    rq = mkEmptyProcQ();
+    r1 = allocPcb();
+    r2 = allocPcb();
+    r3 = allocPcb();
+    w1 = allocPcb();
+    w2 = allocPcb();
+
+    success &= initRWLock(&rw, RW_WRITER_PREF);
+    success &= readLock(&rw, r1);
+    success &= readLock(&rw, r2);
+    success &= !writeLock(&rw, w1);
+    /* A writer waits, so new readers queue behind it. */
+    success &= !readLock(&rw, r3);
+    success &= readUnlock(&rw, &rq) == 0;
+    success &= readUnlock(&rw, &rq) == 1;
+    success &= removeProcQ(&rq) == w1;
+    success &= !writeLock(&rw, w2);
+    success &= writeUnlock(&rw, &rq) == 1;
+    success &= removeProcQ(&rq) == w2;
+    success &= writeUnlock(&rw, &rq) == 1;
+    success &= removeProcQ(&rq) == r3;
+    success &= readUnlock(&rw, &rq) == 0;
+
+    success &= initRWLock(&rw, RW_READER_PREF);
+    success &= readLock(&rw, r1);
+    success &= !writeLock(&rw, w1);
+    success &= readLock(&rw, r2);
+    success &= readUnlock(&rw, &rq) == 0;
+    success &= readUnlock(&rw, &rq) == 1;
+    success &= removeProcQ(&rq) == w1;
+    success &= !readLock(&rw, r1);
+    success &= !readLock(&rw, r2);
+    success &= !writeLock(&rw, w2);
+    /* All waiting readers are released together. */
+    success &= writeUnlock(&rw, &rq) == 2;
+    success &= removeProcQ(&rq) == r1;
+    success &= removeProcQ(&rq) == r2;
+
+    return success;
+}
+
+
+int test_chan(void) {
+    int success = 1;
+    chan_t c, d, e;
+    pcb_t *p1, *p2, *p3;
+    pcbq_t *rq;
+    int msgs[4] = { 10, 11, 12, 13 };
+    void *out[4];
+    void *in[4];
+
+    initASL();
+    initProc();
+    initChanPool();
+
+    rq = mkEmptyProcQ();
+    p1 = allocPcb();
+    p2 = allocPcb();
+    p3 = allocPcb();
+
+    success &= !initChan(&c, MAXCHANSLOTS + 1);
+    success &= initChan(&c, 3);
+
+    out[0] = &msgs[0]; out[1] = &msgs[1];
+    out[2] = &msgs[2]; out[3] = &msgs[3];
+
+    /* Receivers block on an empty channel and are woken by a batch. */
+    success &= chanRecv(&c, p2, in, &rq) == 0;
+    success &= chanRecv(&c, p3, in, &rq) == 0;
+    success &= chanSendN(&c, p1, out, 4, &rq) == 3;
+    success &= removeProcQ(&rq) == p2;
+    success &= removeProcQ(&rq) == p3;
+    success &= emptyProcQ(rq);
+
+    /* A full channel blocks its sender. */
+    success &= chanSend(&c, p1, out[3], &rq) == 0;
+    success &= chanRecvN(&c, p2, in, 4, &rq) == 3;
+    success &= in[0] == &msgs[0] && in[2] == &msgs[2];
+    success &= removeProcQ(&rq) == p1;
+    success &= chanSend(&c, p1, out[3], &rq) == 1;
+    success &= chanRecv(&c, p2, in, &rq) == 1;
+    success &= in[0] == &msgs[3];
+
+    /* A channel with waiters is not freed. */
+    success &= chanRecv(&c, p2, in, &rq) == 0;
+    success &= !freeChan(&c);
+    success &= chanSend(&c, p1, out[0], &rq) == 1;
+    success &= removeProcQ(&rq) == p2;
+    success &= chanRecv(&c, p2, in, &rq) == 1 && in[0] == &msgs[0];
+
+    /* Freed slots go back to the pool, merged with their neighbours. */
+    success &= initChan(&d, MAXCHANSLOTS - 3);
+    success &= !initChan(&e, 1);
+    success &= freeChan(&c);
+    success &= !freeChan(&c);
+    success &= initChan(&e, 1);
+    success &= freeChan(&d);
+    success &= freeChan(&e);
+    success &= initChan(&d, MAXCHANSLOTS);
+    success &= freeChan(&d);
+
+    return success;
+}
+
+
+int test_condvar(void) {
+    int success = 1;
+    mutex_t m;
+    condvar_t cv;
+    pcb_t *p1, *p2, *p3;
+    pcbq_t *rq;
+
+    initASL();
+    initProc();
+
+    rq = mkEmptyProcQ();
+    p1 = allocPcb();
+    p2 = allocPcb();
+    p3 = allocPcb();
+
+    initMutex(&m);
+    initCond(&cv);
+
+    success &= condSignal(&cv, &rq) == NULL;
+
+    mutexLock(&m, p1);
+    condWait(&cv, &m, p1, &rq);
+    mutexLock(&m, p2);
+    condWait(&cv, &m, p2, &rq);
+    mutexLock(&m, p3);
+    success &= emptyProcQ(rq);
+
+    success &= condSignal(&cv, &rq) == p1;
+    condBroadcast(&cv, &rq);
+    success &= removeProcQ(&rq) == p1;
+    success &= removeProcQ(&rq) == p2;
+    success &= emptyProcQ(rq);
+    success &= condSignal(&cv, &rq) == NULL;
+
+    return success;
+}
+
+
+int test_edf(void) {
+    int success = 1;
+    int i;
+    pcb_t *procs[6];
+    edfstats_t st;
+    unsigned int now;
+    /* Deadlines given out of order, some of them equal. */
+    unsigned int dl[6] = { 50, 10, 40, 10, 30, 20 };
+
+    initProc();
+    initEDF();
+
+    for (i = 0; i < 6; ++i) {
+        procs[i] = allocPcb();
+        success &= edfAdmit(procs[i], 1, 8);
+    }
+    /* 6/8 of the CPU is taken, 1/2 more does not fit. */
+    success &= !edfAdmit(allocPcb(), 4, 8);
+
+    now = readTOD();
+    for (i = 0; i < 6; ++i)
+        edfInsert(procs[i], now + dl[i]);
+
+    success &= edfHead() == procs[1] || edfHead() == procs[3];
+    success &= edfOut(procs[4]) == procs[4];
+    success &= edfOut(procs[4]) == NULL;
+
+    success &= getPEdf(edfRemoveMin())->e_deadline == now + 10;
+    success &= getPEdf(edfRemoveMin())->e_deadline == now + 10;
+    success &= edfRemoveMin() == procs[5];
+    success &= edfRemoveMin() == procs[2];
+    success &= edfRemoveMin() == procs[0];
+    success &= edfRemoveMin() == NULL;
+
+    /* One job finishes early, one late. */
+    edfInsert(procs[0], readTOD() + 1000000);
+    edfInsert(procs[1], readTOD() - 5);
+    edfComplete(edfRemoveMin());
+    edfComplete(edfRemoveMin());
+    edfStats(&st);
+    success &= st.es_jobs == 2;
+    success &= st.es_misses == 1;
+    success &= st.es_maxLate >= 5;
+    success &= st.es_ready == 0;
+
+    edfLeave(procs[0]);
+    edfStats(&st);
+    success &= st.es_util == 5 * EDF_UTIL_ONE / 8;
+
+    /* A freed process leaves the class and the queue. */
+    edfInsert(procs[1], now);
+    freePcb(procs[1]);
+    edfStats(&st);
+    success &= st.es_util == 4 * EDF_UTIL_ONE / 8 && st.es_ready == 0;
+
+    /* Long periods do not overflow the utilization. */
+    success &= edfAdmit(procs[0], 0x60000000, 0xC0000000);
+    edfStats(&st);
+    success &= st.es_util == EDF_UTIL_ONE;
+
+    return success;
+}
+
+
+int test_timer(void) {
+    int success = 1;
+    pcb_t *p1, *p2, *p3, *p4;
+    pcbq_t *rq = mkEmptyProcQ();
+    timerstats_t st;
+    unsigned int now, next;
+
+    initProc();
+    initTimer(100);
+    now = readTOD();
+    p1 = allocPcb();
+    p2 = allocPcb();
+    p3 = allocPcb();
+
+    /* Nothing to wait for: the timer is off. */
+    success &= !timerNext(NULL);
+
+    /* The timer is set for the first timeout and its slack, or for an
+       earlier quantum end. */
+    timerAdd(p1, now + 1000000);
+    success &= timerNext(&next) && next == now + 1000100;
+    timerAdd(p2, now + 1000050);
+    success &= timerNext(&next) && next == now + 1000100;
+    timerQuantum(now + 500000);
+    success &= timerNext(&next) && next == now + 500000;
+
+    /* Only the timeouts due expire. */
+    timerAdd(p3, now - 10);
+    success &= timerNext(&next) && next == now + 90;
+    success &= timerInterrupt(&rq) == 1;
+    success &= removeProcQ(&rq) == p3 && emptyProcQ(rq);
+    success &= !timerQuantumOver();
+    success &= timerNext(&next) && next == now + 500000;
+
+    /* Timeouts due together expire on one interrupt, in order. */
+    timerAdd(p2, now - 3);
+    timerAdd(p1, now - 5);
+    success &= timerInterrupt(&rq) == 2;
+    success &= removeProcQ(&rq) == p1;
+    success &= removeProcQ(&rq) == p2;
+
+    /* A quantum end is reported once, and then the timer is off. */
+    timerQuantum(now - 1);
+    success &= timerInterrupt(&rq) == 0;
+    success &= timerQuantumOver();
+    success &= !timerQuantumOver();
+    success &= !timerNext(NULL);
+
+    success &= timerCancel(p3) == NULL;
+    timerAdd(p3, now + 10);
+    success &= timerCancel(p3) == p3;
+    success &= !timerNext(NULL);
+
+    /* An event at TOD 0 is not taken for no event. */
+    timerAdd(p3, (unsigned int) -100);
+    success &= timerNext(&next) && next == 0;
+
+    /* Freeing a process cancels its timeout. */
+    freePcb(p3);
+    success &= !timerNext(NULL);
+
+    timerStats(&st);
+    success &= st.ts_interrupts == 3 && st.ts_expired == 3;
+    success &= st.ts_coalesced == 1 && st.ts_off >= 1;
+
+    return success;
+}
+
+
+#ifdef VALIDATE
+int test_validate(void) {
+    int success = 1;
+    pcb_t *p1, *p2, *p3, *p4;
+    semd_t *s;
+    pcbq_t *q;
+    int n;
+    int i;
+
+    initASL();
+    initProc();
+    checkSetFatal(0);
+    n = checkFailures();
+
+    /* Build a consistent state and sweep it all. */
+    q = mkEmptyProcQ();
+    p1 = allocPcb();
+    p2 = allocPcb();
+    p3 = allocPcb();
+    p4 = allocPcb();
+    insertChild(p1, p2);
+    insertChild(p1, p3);
+    insertProcQ(&q, p2);
+    initSemD(&s, 0);
+    insertBlocked(s, p3);
+    for (i = 0; i < MAXPROCESS; ++i)
+        checkSweep();
+    success &= checkFailures() == n;
+
+    /* Misuses caught by the local checks. */
+    insertProcQ(&q, p2);
+    success &= checkFailures() == n + 1;
+    insertChild(p1, p1);
+    success &= checkFailures() == n + 2;
+    success &= freeSemD(s) == 0;
+    freePcb(p4);
+    freePcb(p4);
+    success &= checkFailures() == n + 3;
+
+    /* A corruption that no operation sees is found by the sweep. */
+    setPSema(p3, NULL);
+    for (i = 0; i < MAXPROCESS && checkFailures() == n + 3; ++i)
+        checkSweep();
+    success &= checkFailures() > n + 3;
+    success &= checkLastFailure() != NULL;
+    setPSema(p3, s);
+
+    checkSetFatal(1);
+    return success;
+}
+#endif
+
+
+int test_pages(void) {
+    int success = 1;
+    unsigned int base = 0x20000000;
+    unsigned int a, b, c, pages[PAGE_CACHE + 1];
+    pagestats_t st;
+    int i;
+#ifdef VALIDATE
+    int n;
+#endif
+
+    /* 37 frames from base (rounded up), the partial pages left out:
+       blocks of 32, 4 and 1 frames. */
+    success &= initPages(base - PAGESIZE + 1, 38) == 37;
+    pageStats(&st);
+    success &= st.ps_total == 37 && st.ps_free == 37;
+    success &= st.ps_blocks[5] == 1 && st.ps_blocks[2] == 1;
+    success &= st.ps_blocks[0] == 1 && st.ps_largest == 5;
+    success &= st.ps_frag[0] == 0 && st.ps_frag[3] == 5 * 1000 / 37;
+
+    /* The single frame is used first; then the block of 4 is split. */
+    a = allocPages(0);
+    success &= a == base + 36 * PAGESIZE;
+    b = allocPages(1);
+    success &= b == base + 32 * PAGESIZE;
+    c = allocPages(0);
+    success &= c == base + 34 * PAGESIZE;
+    success &= allocPages(6) == 0;
+    success &= allocPages(PAGE_MAXORDER + 1) == 0;
+
+    /* Freeing merges the buddies back. */
+    success &= freePages(b);
+    success &= !freePages(b + PAGESIZE);
+    success &= freePages(c);
+    success &= freePages(a);
+    pageStats(&st);
+    success &= st.ps_free == 37 && st.ps_blocks[2] == 1;
+    success &= allocPages(5) == base;
+    success &= freePages(base);
+
+    /* Single frames go through the cache of the processor. */
+    for (i = 0; i <= PAGE_CACHE; ++i)
+        pages[i] = allocPage();
+    pageStats(&st);
+    success &= st.ps_cached == PAGE_CACHE / 2 - 1;
+    success &= st.ps_free == 37 - (PAGE_CACHE + 1) - st.ps_cached;
+    for (i = 0; i <= PAGE_CACHE; ++i)
+        success &= freePage(pages[i]);
+    success &= !freePage(base + 40 * PAGESIZE);
+    /* A cached frame is free: freeing it again is ignored, and reported
+       in validation mode. */
+#ifdef VALIDATE
+    checkSetFatal(0);
+    n = checkFailures();
+#endif
+    success &= !freePage(pages[PAGE_CACHE]);
+#ifdef VALIDATE
+    success &= checkFailures() == n + 1;
+    checkSetFatal(1);
+#endif
+    success &= !pageRef(pages[PAGE_CACHE]) && !pageRefs(pages[PAGE_CACHE]);
+    pageStats(&st);
+    success &= st.ps_cached > 0 && st.ps_cached <= PAGE_CACHE;
+    drainPages();
+    pageStats(&st);
+    success &= st.ps_cached == 0 && st.ps_free == 37;
+    success &= st.ps_blocks[5] == 1;
+
+    return success;
+}
+
+
+static aspace_t SPACES[AS_NASID];
+
+int test_as(void) {
+    int success = 1;
+    aspace_t *as1, *as2;
+    asstats_t st;
+    unsigned int asid;
+    int i;
+
+    initProc();
+    initAS();
+    as1 = getPAs(allocPcb());
+    as2 = getPAs(allocPcb());
+
+    /* Text pages from the start of kuseg, and the stack page. */
+    success &= asMap(as1, AS_KUSEG_START + 0x10, 0x20010000, 0);
+    success &= asMap(as1, AS_KUSEG_STACK - 4, 0x20011000, 1);
+    success &= !asMap(as1, AS_KUSEG_START + AS_NPTE * 0x1000, 0x20012000, 1);
+    success &= asEntryLo(as1, AS_KUSEG_START) == (0x20010000 | AS_VALID);
+    success &= asEntryLo(as1, (AS_KUSEG_STACK - 0x1000) | (5 << AS_ASID_SHIFT))
+        == (0x20011000 | AS_VALID | AS_DIRTY);
+    success &= asEntryLo(as1, AS_KUSEG_START + 0x1000) == 0;
+    success &= asEntryLo(as2, AS_KUSEG_START) == 0;
+
+    /* An address space keeps its ASID from one activation to the next. */
+    asActivate(as1);
+    asid = as1->as_asid;
+    asActivate(as2);
+    asActivate(as1);
+    success &= as1->as_asid == asid && as2->as_asid != asid;
+    asStats(&st);
+    success &= st.as_asids == 2 && st.as_rollovers == 0;
+
+    /* Running out of ASIDs starts a new generation. */
+    for (i = 0; i < AS_NASID; ++i) {
+        SPACES[i].as_asid = 0;
+        asActivate(&SPACES[i]);
+        success &= (SPACES[i].as_asid & (AS_NASID - 1)) != 0;
+    }
+    asStats(&st);
+    success &= st.as_rollovers == 1;
+    asActivate(as1);
+    success &= as1->as_asid != asid;
+
+    /* Mapping a new page leaves the TLB alone; replacing a mapped page
+       makes the TLB forget the space that is not running. */
+    asActivate(as2);
+    asid = as1->as_asid;
+    success &= asMap(as1, AS_KUSEG_START + 0x1000, 0x20012000, 1);
+    success &= as1->as_asid == asid;
+    success &= asMap(as1, AS_KUSEG_START + 0x1000, 0x20013000, 1);
+    success &= as1->as_asid == 0;
+    asUnmap(as1, AS_KUSEG_START + 0x1000);
+    asActivate(as1);
+
+    /* Unmapping from the running space only drops its TLB entry... */
+    asid = as1->as_asid;
+    asUnmap(as1, AS_KUSEG_START);
+    success &= asEntryLo(as1, AS_KUSEG_START) == 0;
+    success &= as1->as_asid == asid;
+
+    /* ...unless it ran on another processor with this ASID: it takes a
+       new one at once. */
+    asMap(as1, AS_KUSEG_START, 0x20010000, 0);
+    as1->as_cpus |= 1u << (cpuId() + 1) % MAXCPU;
+    asUnmap(as1, AS_KUSEG_START);
+    success &= as1->as_asid != 0 && as1->as_asid != asid;
+    success &= as1->as_cpus == 1u << cpuId();
+
+    /* A space that is not running gives up its ASID. */
+    asActivate(as2);
+    asUnmap(as1, AS_KUSEG_STACK - 4);
+    success &= as1->as_asid == 0;
+
+    return success;
+}
+
+
+/* Frames for test_cow, which are really written: one more than used,
+ * as they start at the first page boundary. */
+static char ARENA[9 * PAGESIZE];
+#define ARENA_BASE \
+    (((unsigned int) ARENA + PAGESIZE - 1) / PAGESIZE * PAGESIZE)
+
+int test_cow(void) {
+    int success = 1;
+    pcb_t *p1, *p2;
+    aspace_t *as1, *as2;
+    unsigned int f, g;
+    unsigned int *w;
+    asstats_t st;
+    pagestats_t ps;
+
+    initProc();
+    initAS();
+    initPages(ARENA_BASE, 8);
+    p1 = allocPcb();
+    p2 = allocPcb();
+    as1 = getPAs(p1);
+    as2 = getPAs(p2);
+
+    f = allocPage();
+    w = (unsigned int *) f;
+    w[0] = 0xCAFE;
+    asMap(as1, AS_KUSEG_START, f, 1);
+
+    /* After the fork, the page is shared and read-only. */
+    success &= asFork(as1, as2);
+    success &= pageRefs(f) == 2;
+    success &= asEntryLo(as1, AS_KUSEG_START) == (f | AS_VALID | AS_COW);
+    success &= asEntryLo(as2, AS_KUSEG_START) == (f | AS_VALID | AS_COW);
+
+    /* The first writer gets a copy... */
+    success &= asWriteFault(as2, AS_KUSEG_START);
+    g = asEntryLo(as2, AS_KUSEG_START);
+    success &= (g & AS_PFN_MASK) != f && (g & AS_DIRTY) && !(g & AS_COW);
+    success &= *(unsigned int *) (g & AS_PFN_MASK) == 0xCAFE;
+    success &= pageRefs(f) == 1;
+
+    /* ...and the last one keeps the frame. */
+    success &= asWriteFault(as1, AS_KUSEG_START);
+    success &= asEntryLo(as1, AS_KUSEG_START) == (f | AS_VALID | AS_DIRTY);
+    success &= !asWriteFault(as1, AS_KUSEG_START);
+    asStats(&st);
+    success &= st.as_cowCopies == 1 && st.as_cowReuses == 1;
+
+    /* Every frame comes back when the processes are freed. */
+    freePcb(p1);
+    freePcb(p2);
+    drainPages();
+    pageStats(&ps);
+    success &= ps.ps_free == 8;
+
+    return success;
+}
+
+
+int test_swap(void) {
+    int success = 1;
+    diskq_t dq;
+    swaparea_t area;
+    swapstats_t st;
+    pagestats_t ps;
+    pcb_t *pager, *p;
+    pcbq_t *rq;
+    aspace_t *as;
+    ioreq_t *r;
+    unsigned int v0 = AS_KUSEG_START;
+    unsigned int v1 = AS_KUSEG_START + PAGESIZE;
+    unsigned int v2 = AS_KUSEG_START + 2 * PAGESIZE;
+    /* w0 w1 w2 r1 r0 w3 r2: a write to page n is n + 4. */
+    static const int SEQ[7] = {4, 5, 6, 1, 0, 7, 2};
+    unsigned int f0, f1;
+    int write, i;
+
+    initASL();
+    initProc();
+    initIOReq();
+    initAS();
+    initPages(ARENA_BASE, 8);
+    initDiskQ(&dq, IL_DISK, 0, DQ_FIFO);
+
+    rq = mkEmptyProcQ();
+    pager = allocPcb();
+    p = allocPcb();
+    as = getPAs(p);
+    area.sa_dq = &dq;
+    area.sa_heads = 2;
+    area.sa_sects = 8;
+    area.sa_cyl = 1;
+    area.sa_slots = 16;
+    success &= initSwap(&area, pager, 2) == 2;
+
+    success &= swapReserve(as, v0, 1);
+    success &= swapReserve(as, v1, 1);
+    success &= swapReserve(as, v2, 0);
+    success &= !swapReserve(as, 0x1000, 1);
+    success &= swapFault(p, 0x1000, 0) == -1;
+    success &= swapFault(p, v2, 1) == -1;
+
+    /* Zero pages need no transfer; a clean page is writable only after
+       its first write faults. */
+    success &= swapFault(p, v0, 1) == 1;
+    f0 = asEntryLo(as, v0);
+    success &= (f0 & AS_VALID) && (f0 & AS_DIRTY);
+    f0 &= AS_PFN_MASK;
+    success &= *(unsigned int *) f0 == 0;
+
+    /* Frames and slots are not shared: the space cannot be forked. */
+    success &= !asFork(as, getPAs(pager));
+    success &= asEntryLo(getPAs(pager), v0) == 0;
+    success &= (asEntryLo(as, v0) & AS_DIRTY) != 0;
+    *(unsigned int *) f0 = 0xA0;
+    success &= swapFault(p, v1, 0) == 1;
+    success &= !(asEntryLo(as, v1) & AS_DIRTY);
+    success &= swapFault(p, v1, 1) == 1;
+    success &= (asEntryLo(as, v1) & AS_DIRTY) != 0;
+    f1 = asEntryLo(as, v1) & AS_PFN_MASK;
+    *(unsigned int *) f1 = 0xA1;
+
+    /* Both frames are dirty: they are written back in one transfer, and
+       the fault waits for a frame. */
+    success &= swapFault(p, v2, 0) == 0;
+    success &= !(asEntryLo(as, v0) & AS_VALID);
+    r = diskStart(&dq);
+    success &= r != NULL && r->r_proc == pager && r->r_count == 2;
+    success &= r->r_cyl == 1 && r->r_head == 0 && r->r_sect == 0;
+    success &= swapSector(r, 0, &write) == f0 && write;
+    success &= swapSector(r, 1, &write) == f1 && write;
+    success &= swapDiskDone(&rq) == 1;
+    success &= removeProcQ(&rq) == p;
+
+    /* Now clean, the page of v0 is evicted for v2... */
+    success &= swapFault(p, v2, 0) == 1;
+    success &= (asEntryLo(as, v2) & AS_PFN_MASK) == f0;
+
+    /* ...and read back in the frame of v1, evicted in turn. */
+    success &= swapFault(p, v0, 0) == 0;
+    r = diskStart(&dq);
+    success &= r != NULL && r->r_proc == p && r->r_count == 1;
+    success &= swapSector(r, 0, &write) == f1 && !write;
+    *(unsigned int *) f1 = 0xA0;
+    success &= swapDiskDone(&rq) == 1;
+    success &= removeProcQ(&rq) == p;
+    success &= (asEntryLo(as, v0) & (AS_PFN_MASK | AS_VALID | AS_DIRTY)) ==
+        (f1 | AS_VALID);
+
+    swapStats(&st);
+    success &= st.sw_major == 1 && st.sw_minor == 0 && st.sw_zero == 3;
+    success &= st.sw_pageIns == 1 && st.sw_readAhead == 0;
+    success &= st.sw_pageOuts == 2 && st.sw_batches == 1;
+    success &= st.sw_frameWaits == 1;
+
+    /* The frames stay with the pager. */
+    swapRelease(as);
+    asFree(as);
+    success &= asEntryLo(as, v1) == 0;
+    drainPages();
+    pageStats(&ps);
+    success &= ps.ps_free == 6;
+
+    /* A fault on a page queued in a partial batch submits the batch,
+       even though the pager is idle. */
+    initIOReq();
+    initDiskQ(&dq, IL_DISK, 0, DQ_FIFO);
+    success &= initSwap(&area, pager, 2) == 2;
+    swapSetReadAhead(1);
+    for (i = 0; i < 4; ++i)
+        success &= swapReserve(as, AS_KUSEG_START + i * PAGESIZE, 1);
+    for (i = 0; i < 7; ++i) {
+        v0 = AS_KUSEG_START + SEQ[i] % 4 * PAGESIZE;
+        while (swapFault(p, v0, SEQ[i] >= 4) == 0) {
+            r = diskStart(&dq);
+            success &= r != NULL;
+            if (r == NULL)
+                break;
+            swapDiskDone(&rq);
+            while (removeProcQ(&rq) != NULL)
+                ;
+        }
+        success &= (asEntryLo(as, v0) & AS_VALID) != 0;
+    }
+
+    /* Freeing the process gives its frames back at once: they are not
+       evicted into the space of the next process. */
+    success &= swapFault(p, v2, 1) == 1;
+    freePcb(p);
+    success &= asEntryLo(as, v2) == 0;
+    p = allocPcb();
+    success &= swapReserve(getPAs(p), v1, 1);
+    success &= swapFault(p, v1, 1) == 1;
+    success &= asEntryLo(getPAs(p), v2) == 0;
+    swapRelease(getPAs(p));
+    asFree(getPAs(p));
+
+    return success;
+}
+
+static ring_t RING;
+
+int test_ring(void) {
+    int success = 1;
+    pcb_t *p, *q;
+    semd_t *s;
+    diskq_t dq;
+    pcbq_t *rq;
+    sqe_t *e;
+    cqe_t c;
+    int i;
+
+    initASL();
+    initProc();
+    initIOReq();
+    initDiskQ(&dq, IL_DISK, 0, DQ_FIFO);
+
+    rq = mkEmptyProcQ();
+    p = allocPcb();
+    q = allocPcb();
+    initSemDPerm(&s, 0);
+    ringInit(&RING);
+
+    /* V, P, fork, then a P that blocks, and a V behind it. */
+    e = ringGetSQE(&RING);
+    e->sq_op = RING_V; e->sq_tag = 1; e->sq_sem = s; e->sq_units = 1;
+    e = ringGetSQE(&RING);
+    e->sq_op = RING_P; e->sq_tag = 2; e->sq_sem = s; e->sq_units = 1;
+    e = ringGetSQE(&RING);
+    e->sq_op = RING_FORK; e->sq_tag = 3;
+    e = ringGetSQE(&RING);
+    e->sq_op = RING_P; e->sq_tag = 4; e->sq_sem = s; e->sq_units = 1;
+    e = ringGetSQE(&RING);
+    e->sq_op = RING_V; e->sq_tag = 5; e->sq_sem = s; e->sq_units = 2;
+
+    success &= ringEnter(&RING, p, &rq) == 3;
+    success &= getPState(p) == PS_BLOCKED;
+    success &= RING.r_enters == 1 && RING.r_ops == 4;
+
+    /* Completions are reaped without entering the kernel. */
+    success &= ringReap(&RING, &c) && c.cq_tag == 1 && c.cq_res == 0;
+    success &= ringReap(&RING, &c) && c.cq_tag == 2 && c.cq_res == 1;
+    success &= ringReap(&RING, &c) && c.cq_tag == 3 && c.cq_res == 1;
+    success &= getPParent(c.cq_child) == p && headProcQ(rq) == c.cq_child;
+    success &= !ringReap(&RING, &c);
+
+    /* Once woken, p carries on with the rest of the batch. */
+    success &= ringEnter(&RING, p, &rq) == 0;
+    verhogenN(s, 1, &rq);
+    success &= getPState(p) == PS_READY;
+    success &= ringEnter(&RING, p, &rq) == 2;
+    success &= ringReap(&RING, &c) && c.cq_tag == 4 && c.cq_res == 1;
+    success &= ringReap(&RING, &c) && c.cq_tag == 5 && c.cq_res == 0;
+    success &= getSValue(s) == 2;
+
+    /* Entries wait for room in the completion queue. */
+    for (i = 0; i < RING_SIZE; ++i) {
+        e = ringGetSQE(&RING);
+        e->sq_op = RING_V; e->sq_tag = i; e->sq_sem = s; e->sq_units = 0;
+    }
+    success &= ringGetSQE(&RING) == NULL;
+    success &= ringEnter(&RING, q, &rq) == RING_SIZE;
+    for (i = 0; i < RING_SIZE; ++i) {
+        e = ringGetSQE(&RING);
+        e->sq_op = -1; e->sq_tag = i;
+    }
+    success &= ringEnter(&RING, q, &rq) == 0;
+    success &= ringReap(&RING, &c) && c.cq_tag == 0;
+    success &= ringEnter(&RING, q, &rq) == 1;
+    for (i = 0; i < RING_SIZE; ++i)
+        success &= ringReap(&RING, &c);
+    success &= c.cq_tag == 0 && c.cq_res == -1;
+
+    /* A transfer completes from the wake path, with its status. */
+    ringInit(&RING);
+    outProcQ(&rq, p);
+    e = ringGetSQE(&RING);
+    e->sq_op = RING_IO; e->sq_tag = 6; e->sq_dq = &dq; e->sq_count = 1;
+    e = ringGetSQE(&RING);
+    e->sq_op = RING_V; e->sq_tag = 7; e->sq_sem = s; e->sq_units = 0;
+    success &= ringEnter(&RING, p, &rq) == 0;
+    success &= getPState(p) == PS_BLOCKED;
+    success &= !ringComplete(q, 1);
+    success &= diskStart(&dq) != NULL && diskDone(&dq, &rq) == 1;
+    success &= ringComplete(p, -5) && !ringComplete(p, 1);
+    success &= ringReap(&RING, &c) && c.cq_tag == 6 && c.cq_res == -5;
+    success &= !ringReap(&RING, &c);
+    success &= ringEnter(&RING, p, &rq) == 1;
+    success &= ringReap(&RING, &c) && c.cq_tag == 7;
+
+    return success;
+}
+
+
+int test_diskq(void) {
+    int success = 1;
+    diskq_t dq;
+    diskstats_t st;
+    pcb_t *p1, *p2, *p3, *p4;
+    pcbq_t *rq;
+    ioreq_t *r;
+
+    initASL();
+    initProc();
+    initIOReq();
+
+    rq = mkEmptyProcQ();
+    p1 = allocPcb();
+    p2 = allocPcb();
+    p3 = allocPcb();
+    p4 = allocPcb();
+
+    success &= !initDiskQ(&dq, IL_TERMINAL, 0, DQ_CSCAN);
+    success &= initDiskQ(&dq, IL_DISK, 0, DQ_CSCAN);
+
+    /* The arm is moved to cylinder 50 first. */
+    diskSubmit(&dq, p1, 50, 0, 0, 1, 0, NULL);
+    r = diskStart(&dq);
+    success &= r != NULL && r->r_cyl == 50;
+    success &= diskStart(&dq) == NULL;
+
+    diskSubmit(&dq, p2, 10, 0, 4, 2, 0, ARENA + 4 * DISK_SECTSIZE);
+    diskSubmit(&dq, p3, 70, 1, 0, 1, 0, NULL);
+    diskSubmit(&dq, p4, 10, 0, 6, 3, 0, ARENA);
+    success &= diskDone(&dq, &rq) == 1;
+    success &= removeProcQ(&rq) == p1;
+
+    /* A write is not merged with the reads next to it. */
+    diskSubmit(&dq, p1, 10, 0, 9, 1, 1, NULL);
+
+    /* C-SCAN goes on upwards, then wraps to the merged request. */
+    r = diskStart(&dq);
+    success &= r->r_cyl == 70;
+    success &= diskDone(&dq, &rq) == 1;
+    r = diskStart(&dq);
+    success &= r->r_cyl == 10 && r->r_sect == 4 && r->r_count == 5;
+    success &= !r->r_write;
+    success &= diskBuffer(r, 1) == ARENA + 5 * DISK_SECTSIZE;
+    success &= diskBuffer(r, 2) == ARENA;
+    success &= diskBuffer(r, 4) == ARENA + 2 * DISK_SECTSIZE;
+    success &= diskBuffer(r, 5) == NULL;
+    success &= diskDone(&dq, &rq) == 2;
+    r = diskStart(&dq);
+    success &= r->r_sect == 9 && r->r_count == 1 && r->r_write;
+    success &= diskDone(&dq, &rq) == 1;
+    success &= diskStart(&dq) == NULL;
+    success &= headBlocked(getDevSemD(IL_DISK, 0, 0)) == NULL;
+
+    diskStats(&dq, &st);
+    success &= st.ds_requests == 5;
+    success &= st.ds_transfers == 4;
+    success &= st.ds_merged == 1;
+    success &= st.ds_seekDist == 50 + 20 + 60;
+
+    return success;
+}
+
+
 
 void main(void)
 {
     test("test_initProc", test_initProc);
     test("test_allocFreeCount", test_allocFreeCount);
     test("test_allocFreeNull", test_allocFreeNull);
+    test("test_procState", test_procState);
+    test("test_acct", test_acct);
+    test("test_freeHook", test_freeHook);
     test("test_EmptyProcQ", test_EmptyProcQ);
     test("test_insertProcQ", test_insertProcQ);
     test("test_removeProcQ", test_removeProcQ);
     test("test_outProcQ", test_outProcQ);
     test("test_headProcQ", test_headProcQ);
+    test("test_moveProcQ", test_moveProcQ);
+    test("test_spliceProcQ", test_spliceProcQ);
     test("test_emptyChild", test_emptyChild);
     test("test_removeChild", test_removeChild);
     test("test_outChild", test_outChild);
+    test("test_rcu", test_rcu);
 
     test("test_initASL", test_initASL);
     test("test_initSemD", test_initSemD);
     /*test("test_initSemDExhaustion", test_initSemDExhaustion);*/
+    test("test_initSemDEmbed", test_initSemDEmbed);
     test("test_insertBlocked", test_insertBlocked);
     test("test_removeBlocked", test_removeBlocked);
     test("test_outBlocked", test_removeBlocked);
     test("test_headBlocked", test_removeBlocked);
+    test("test_moveBlocked", test_moveBlocked);
+    test("test_passerenVerhogenN", test_passerenVerhogenN);
+    test("test_semSpin", test_semSpin);
+    test("test_devSemD", test_devSemD);
+#ifdef SEMA_PROFILE
+    test("test_semProf", test_semProf);
+#endif
+#ifdef LATENCY_PROFILE
+    test("test_latProf", test_latProf);
+#endif
+    test("test_mutex", test_mutex);
+    test("test_rwlock", test_rwlock);
+    test("test_chan", test_chan);
+    test("test_condvar", test_condvar);
+    test("test_edf", test_edf);
+    test("test_diskq", test_diskq);
+    test("test_pages", test_pages);
+    test("test_as", test_as);
+    test("test_cow", test_cow);
+    test("test_swap", test_swap);
+    test("test_ring", test_ring);
+    test("test_timer", test_timer);
+#ifdef VALIDATE
+    test("test_validate", test_validate);
+#endif
 
 
     /* Go to sleep and power off the machine if anything wakes us up */